@@ -1,19 +1,8 @@
-#include <ds3231.h>
+#include "ds3231_priv.h"
+#include <ds3231_alarm.h>
+#include <ds3231_tz.h>
 #include <stdlib.h>
-
-#define DS3231_ADDR     0x68
-#define DS3231_CAL_REG  0x00
-#define DS3231_ALM1_REG 0x07
-#define DS3231_ALM2_REG 0x0B
-#define DS3231_CTRL_REG 0x0E
-#define DS3231_CS_REG   0x0F
-#define DS3231_AGE_REG  0x10
-#define DS3231_TEMP_REG 0x11
-
-struct DS3231_Cfg
-{
-  i2c_port_t i2c_port;
-};
+#include <string.h>
 
 typedef struct _internal_ds3231_calendar_s
 {
@@ -110,12 +99,14 @@ typedef struct _internal_ds3231_ctrlstat_s
 
 static void ds3231_convert_ext_calendar(DS3231_Calendar_t* in, Internal_DS3231_Calendar_t* out);
 static void ds3231_convert_int_calendar(DS3231_Calendar_t* out, Internal_DS3231_Calendar_t* in);
-static esp_err_t ds3231_i2c_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t);
-static esp_err_t ds3231_i2c_write(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t);
+#if CONFIG_DS3231_ALARMS
 static esp_err_t ds3231_get_alarm1(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout);
 static esp_err_t ds3231_get_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout);
 static esp_err_t ds3231_set_alarm1(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout);
 static esp_err_t ds3231_set_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout);
+static void ds3231_encode_alarm1(const DS3231_AlarmSetting_t* alarm, Internal_DS3231_Alarm1_t* out);
+static void ds3231_encode_alarm2(const DS3231_AlarmSetting_t* alarm, Internal_DS3231_Alarm2_t* out);
+#endif
 
 static inline esp_err_t ds3231_get_ctrl(DS3231_Cfg_t cfg, Internal_DS3231_Control_t* ctrl, TickType_t timeout)
 {
@@ -139,36 +130,48 @@ static inline esp_err_t ds3231_set_cs(DS3231_Cfg_t cfg, Internal_DS3231_CtrlStat
 
 DS3231_Cfg_t ds3231_create(i2c_port_t i2c_port)
 {
-  DS3231_Cfg_t cfg = (DS3231_Cfg_t)malloc(sizeof(*cfg));
+  DS3231_Cfg_t cfg = (DS3231_Cfg_t)calloc(1, sizeof(*cfg));
   if (!cfg)
     return NULL;
 
   cfg->i2c_port = i2c_port;
-  i2c_cmd_handle_t i2c_cmd_handle = i2c_cmd_link_create();
-  i2c_master_start(i2c_cmd_handle);
-  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_WRITE, true);
-  i2c_master_stop(i2c_cmd_handle);
-  esp_err_t res = i2c_master_cmd_begin(cfg->i2c_port, i2c_cmd_handle, pdMS_TO_TICKS(1));
-  i2c_cmd_link_delete(i2c_cmd_handle);
-
+  esp_err_t res = ds3231_i2c_open(cfg);
   if (res != ESP_OK)
   {
     free(cfg);
-    cfg = NULL;
+    return NULL;
   }
 
+  ds3231_port_lock_init(&cfg->kv_lock);
+#if CONFIG_DS3231_TRACE
+  ds3231_trace_init(cfg);
+#endif
+#if CONFIG_DS3231_READ_CACHE
+  ds3231_cache_init(cfg);
+#endif
+
   return cfg;
 }
 
 esp_err_t ds3231_get_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, TickType_t timeout)
 {
   Internal_DS3231_Calendar_t int_calendar;
-  esp_err_t res = ds3231_i2c_read(cfg, DS3231_CAL_REG, (uint8_t*)&int_calendar, sizeof(int_calendar), timeout);
+  esp_err_t res = ds3231_cache_read(cfg, DS3231_CAL_REG, (uint8_t*)&int_calendar, sizeof(int_calendar), timeout);
   if (res == ESP_OK)
     ds3231_convert_int_calendar(calendar, &int_calendar);
   return res;
 }
 
+esp_err_t ds3231_get_local_calendar(DS3231_Cfg_t cfg, struct DS3231_Tz* tz, DS3231_Calendar_t* calendar,
+                                    TickType_t timeout)
+{
+  DS3231_Calendar_t utc;
+  esp_err_t res = ds3231_get_calendar(cfg, &utc, timeout);
+  if (res == ESP_OK)
+    ds3231_tz_local_calendar(tz, &utc, calendar);
+  return res;
+}
+
 esp_err_t ds3231_set_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, TickType_t timeout)
 {
   Internal_DS3231_Calendar_t int_calendar;
@@ -176,27 +179,75 @@ esp_err_t ds3231_set_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, Tic
   return ds3231_i2c_write(cfg, DS3231_CAL_REG, (uint8_t*)&int_calendar, sizeof(int_calendar), timeout);
 }
 
+#if CONFIG_DS3231_TEMPERATURE
+esp_err_t ds3231_get_temperature_q2(DS3231_Cfg_t cfg, int16_t* temperature_q2, TickType_t timeout)
+{
+  uint8_t temp_data[DS3231_TEMP_LEN];
+  esp_err_t res = ds3231_cache_read(cfg, DS3231_TEMP_REG, temp_data, sizeof(temp_data), timeout);
+
+  if (res == ESP_OK && temperature_q2)
+    *temperature_q2 = ds3231_raw_temperature_q2(temp_data);
+
+  return res;
+}
+
+esp_err_t ds3231_get_calendar_temperature_q2(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, int16_t* temperature_q2,
+                                             TickType_t timeout)
+{
+  uint8_t regs[DS3231_REG_COUNT];
+  esp_err_t res = ds3231_i2c_read(cfg, DS3231_CAL_REG, regs, sizeof(regs), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  // a conversion finishing part way through the burst could tear the temperature registers; the time registers were
+  // latched at the start of the transaction. While BSY is set, re-read status and temperature until BSY has cleared or
+  // two reads agree, as an update cannot tear both.
+  uint8_t* temp = &regs[DS3231_TEMP_REG];
+  for (TickType_t waited = 0; ((Internal_DS3231_CtrlStat_t*)&regs[DS3231_CS_REG])->bsy; waited++)
+  {
+    const uint8_t prev[DS3231_TEMP_LEN] = { temp[0], temp[1] };
+    res = ds3231_i2c_read(cfg, DS3231_CS_REG, &regs[DS3231_CS_REG], DS3231_REG_COUNT - DS3231_CS_REG, timeout);
+    if (res != ESP_OK)
+      return res;
+    if (memcmp(prev, temp, sizeof(prev)) == 0)
+      break;
+    if (waited >= timeout)
+      return ESP_ERR_TIMEOUT;
+    ds3231_port_delay(1);
+  }
+
+  if (calendar)
+    ds3231_convert_int_calendar(calendar, (Internal_DS3231_Calendar_t*)&regs[DS3231_CAL_REG]);
+  if (temperature_q2)
+    *temperature_q2 = ds3231_raw_temperature_q2(temp);
+  return ESP_OK;
+}
+
+#if CONFIG_DS3231_TEMPERATURE_FLOAT
 esp_err_t ds3231_get_temperature(DS3231_Cfg_t cfg, float* temperature, TickType_t timeout)
 {
-  uint8_t temp_data[2];
-  esp_err_t res = ds3231_i2c_read(cfg, DS3231_TEMP_REG, temp_data, sizeof(temp_data), timeout);
+  int16_t temperature_q2;
+  esp_err_t res = ds3231_get_temperature_q2(cfg, &temperature_q2, timeout);
 
   if (res == ESP_OK && temperature)
-  {
-    uint16_t temp = (temp_data[0] << 2) | (temp_data[1] >> 6);
-    if (temp & 0x200)
-    {
-      // if the 10th bit (sign bit) is asserted then assert bits 11-15
-      // this will convert to proper, negative int16_t value.
-      temp |= 0xFC00;
-    }
+    *temperature = temperature_q2 * 0.25f;
 
-    *temperature = (int16_t)temp * 0.25f;
-  }
+  return res;
+}
 
+esp_err_t ds3231_get_calendar_temperature(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, float* temperature,
+                                          TickType_t timeout)
+{
+  int16_t temperature_q2;
+  esp_err_t res = ds3231_get_calendar_temperature_q2(cfg, calendar, &temperature_q2, timeout);
+  if (res == ESP_OK && temperature)
+    *temperature = temperature_q2 * 0.25f;
   return res;
 }
+#endif
+#endif
 
+#if CONFIG_DS3231_ALARMS
 esp_err_t ds3231_get_alarm(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
 {
   if (alarm->alarm_type == DS3231_AlarmType_Alarm1)
@@ -209,6 +260,9 @@ esp_err_t ds3231_get_alarm(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickT
 
 esp_err_t ds3231_set_alarm(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
 {
+  if (ds3231_alarm_validate(alarm) != DS3231_AlarmError_None)
+    return ESP_ERR_INVALID_ARG;
+
   if (alarm->alarm_type == DS3231_AlarmType_Alarm1)
     return ds3231_set_alarm1(cfg, alarm, timeout);
   else if (alarm->alarm_type == DS3231_AlarmType_Alarm2)
@@ -244,6 +298,7 @@ esp_err_t ds3231_set_intr_en(DS3231_Cfg_t cfg, DS3231_Interrupt_t intr_flags, Ti
 
   return ds3231_set_ctrl(cfg, &ctrl, timeout);
 }
+#endif
 
 esp_err_t ds3231_set_square_wave(DS3231_Cfg_t cfg, DS3231_SquareWave_t sqw, TickType_t timeout)
 {
@@ -275,6 +330,7 @@ esp_err_t ds3231_get_square_wave(DS3231_Cfg_t cfg, DS3231_SquareWave_t* square_w
   return ESP_OK;
 }
 
+#if CONFIG_DS3231_TEMPERATURE
 esp_err_t ds3231_set_convert_temperature(DS3231_Cfg_t cfg, TickType_t timeout)
 {
   Internal_DS3231_Control_t ctrl;
@@ -294,6 +350,7 @@ esp_err_t ds3231_get_convert_temperature(DS3231_Cfg_t cfg, uint8_t* conv, TickTy
     *conv = ctrl.conv;
   return res;
 }
+#endif
 
 esp_err_t ds3231_get_osc(DS3231_Cfg_t cfg, DS3231_Oscillator_t* eosc, TickType_t timeout)
 {
@@ -368,6 +425,7 @@ esp_err_t ds3231_clear_osc_stop_flag(DS3231_Cfg_t cfg, TickType_t timeout)
   return ds3231_set_cs(cfg, &cs, timeout);
 }
 
+#if CONFIG_DS3231_ALARMS
 esp_err_t ds3231_get_intr_flag(DS3231_Cfg_t cfg, DS3231_Interrupt_t* intr_flag, TickType_t timeout)
 {
   Internal_DS3231_CtrlStat_t ctrl_status;
@@ -394,6 +452,7 @@ esp_err_t ds3231_clear_intr_flag(DS3231_Cfg_t cfg, DS3231_Interrupt_t intr_flags
 
   return ds3231_set_cs(cfg, &ctrl_status, timeout);
 }
+#endif
 
 esp_err_t ds3231_get_aging_offset(DS3231_Cfg_t cfg, uint8_t* aging_offset, TickType_t timeout)
 {
@@ -405,44 +464,185 @@ esp_err_t ds3231_set_aging_offset(DS3231_Cfg_t cfg, uint8_t aging_offset, TickTy
   return ds3231_i2c_write(cfg, DS3231_AGE_REG, &aging_offset, sizeof(aging_offset), timeout);
 }
 
-void ds3231_delete(DS3231_Cfg_t cfg)
+esp_err_t ds3231_apply_config(DS3231_Cfg_t cfg, const DS3231_Config_t* config, uint32_t* changed_regs,
+                              TickType_t timeout)
 {
-  if (cfg)
-    free(cfg);
+#if CONFIG_DS3231_ALARMS
+  if ((config->alarm1 && (config->alarm1->alarm_type != DS3231_AlarmType_Alarm1 ||
+                          ds3231_alarm_validate(config->alarm1) != DS3231_AlarmError_None)) ||
+      (config->alarm2 && (config->alarm2->alarm_type != DS3231_AlarmType_Alarm2 ||
+                          ds3231_alarm_validate(config->alarm2) != DS3231_AlarmError_None)))
+    return ESP_ERR_INVALID_ARG;
+#else
+  if (config->alarm1 || config->alarm2 || config->intr_en != DS3231_Interrupt_None)
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+
+  // alarms, control, status and aging offset are contiguous, so one read covers everything
+  uint8_t current[DS3231_AGE_REG - DS3231_ALM1_REG + 1];
+  esp_err_t res = ds3231_i2c_read(cfg, DS3231_ALM1_REG, current, sizeof(current), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  uint8_t desired[sizeof(current)];
+  memcpy(desired, current, sizeof(desired));
+#if CONFIG_DS3231_ALARMS
+  if (config->alarm1)
+    ds3231_encode_alarm1(config->alarm1, (Internal_DS3231_Alarm1_t*)&desired[DS3231_ALM1_REG - DS3231_ALM1_REG]);
+  if (config->alarm2)
+    ds3231_encode_alarm2(config->alarm2, (Internal_DS3231_Alarm2_t*)&desired[DS3231_ALM2_REG - DS3231_ALM1_REG]);
+#endif
+
+  Internal_DS3231_Control_t* ctrl = (Internal_DS3231_Control_t*)&desired[DS3231_CTRL_REG - DS3231_ALM1_REG];
+  ctrl->osc_en_n = config->oscillator;
+  ctrl->intr_control = config->intr_en != DS3231_Interrupt_None;
+  ctrl->alarm1_intr_en = (config->intr_en & DS3231_Interrupt_Alarm_1) == DS3231_Interrupt_Alarm_1;
+  ctrl->alarm2_intr_en = (config->intr_en & DS3231_Interrupt_Alarm_2) == DS3231_Interrupt_Alarm_2;
+  if (config->square_wave == DS3231_SquareWave_Off)
+  {
+    ctrl->bbsqw = 0;
+  }
+  else
+  {
+    ctrl->rs = config->square_wave;
+    ctrl->bbsqw = 1;
+  }
+
+  // a conversion in progress is not part of the configuration; writing 0 to CONV does not abort it
+  ctrl->conv = 0;
+  ((Internal_DS3231_Control_t*)&current[DS3231_CTRL_REG - DS3231_ALM1_REG])->conv = 0;
+
+  // only EN32kHz is configured. desired starts as the value read, so OSF and, on the DS3232, BB32kHz and CRATE are
+  // written back unchanged; alarm flags are cleared by writing 0 and unaffected by writing 1, so write 1 to keep one
+  // raised between the read and the write
+  Internal_DS3231_CtrlStat_t* cs = (Internal_DS3231_CtrlStat_t*)&desired[DS3231_CS_REG - DS3231_ALM1_REG];
+  if (cs->en32kHz != config->en_32kHz)
+  {
+    cs->en32kHz = config->en_32kHz;
+    cs->a1f = 1;
+    cs->a2f = 1;
+  }
+
+  desired[DS3231_AGE_REG - DS3231_ALM1_REG] = config->aging_offset;
+
+  uint32_t changed = 0;
+  for (size_t start = 0; start < sizeof(desired) && res == ESP_OK;)
+  {
+    if (desired[start] == current[start])
+    {
+      start++;
+      continue;
+    }
+
+    size_t end = start + 1;
+    while (end < sizeof(desired) && desired[end] != current[end])
+      end++;
+
+    res = ds3231_i2c_write(cfg, DS3231_ALM1_REG + start, &desired[start], end - start, timeout);
+    if (res == ESP_OK)
+      changed |= ((1u << (end - start)) - 1) << (DS3231_ALM1_REG + start);
+    start = end;
+  }
+
+  if (changed_regs)
+    *changed_regs = changed;
+  return res;
 }
 
-static esp_err_t ds3231_i2c_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+esp_err_t ds3231_read_raw(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
 {
-  i2c_cmd_handle_t i2c_cmd_handle = i2c_cmd_link_create();
-  i2c_master_start(i2c_cmd_handle);
-  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_WRITE, true);
-  i2c_master_write_byte(i2c_cmd_handle, reg, true);
-  i2c_master_start(i2c_cmd_handle);
-  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_READ, true);
-  i2c_master_read(i2c_cmd_handle, data, data_len, I2C_MASTER_LAST_NACK);
-  i2c_master_stop(i2c_cmd_handle);
-  esp_err_t res = i2c_master_cmd_begin(cfg->i2c_port, i2c_cmd_handle, timeout);
-  i2c_cmd_link_delete(i2c_cmd_handle);
+  if (!data || data_len == 0)
+    return ESP_ERR_INVALID_ARG;
+  if (reg + data_len > ds3231_reg_count(cfg))
+    return ESP_ERR_INVALID_SIZE;
 
-  return res;
+  return ds3231_i2c_read(cfg, reg, data, data_len, timeout);
+}
+
+esp_err_t ds3231_write_raw(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  if (!data || data_len == 0)
+    return ESP_ERR_INVALID_ARG;
+  if (reg + data_len > ds3231_reg_count(cfg))
+    return ESP_ERR_INVALID_SIZE;
+
+  return ds3231_i2c_write(cfg, reg, data, data_len, timeout);
 }
 
-static esp_err_t ds3231_i2c_write(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+esp_err_t ds3231_detect_variant(DS3231_Cfg_t cfg, DS3231_Variant_t* variant, TickType_t timeout)
 {
-  i2c_cmd_handle_t i2c_cmd_handle = i2c_cmd_link_create();
-  i2c_master_start(i2c_cmd_handle);
-  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_WRITE, true);
-  i2c_master_write_byte(i2c_cmd_handle, reg, true);
-  i2c_master_write(i2c_cmd_handle, data, data_len, true);
-  i2c_master_stop(i2c_cmd_handle);
-  esp_err_t res = i2c_master_cmd_begin(cfg->i2c_port, i2c_cmd_handle, timeout);
-  i2c_cmd_link_delete(i2c_cmd_handle);
+  Internal_DS3231_Control_t ctrl;
+  uint8_t cs;
+  esp_err_t res = ds3231_get_ctrl(cfg, &ctrl, timeout);
+  if (res == ESP_OK)
+    res = ds3231_i2c_read(cfg, DS3231_CS_REG, &cs, sizeof(cs), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  // CRATE1:0 in the status register exist only on the DS3232 and read 0 on the others. Writing 1 to the alarm flags
+  // leaves them unchanged and OSF is written back as read.
+  uint8_t probe = (cs ^ DS3232_CS_CRATE) | 0x03;
+  uint8_t readback;
+  res = ds3231_i2c_write(cfg, DS3231_CS_REG, &probe, sizeof(probe), timeout);
+  if (res == ESP_OK)
+    res = ds3231_i2c_read(cfg, DS3231_CS_REG, &readback, sizeof(readback), timeout);
+  if (res != ESP_OK)
+    return res;
 
+  if ((readback & DS3232_CS_CRATE) == (probe & DS3232_CS_CRATE))
+  {
+    probe = cs | 0x03;
+    res = ds3231_i2c_write(cfg, DS3231_CS_REG, &probe, sizeof(probe), timeout);
+    cfg->variant = DS3231_Variant_DS3232;
+  }
+  else if (ctrl.rs == 0 && ctrl.intr_control)
+  {
+    // the DS3231M has no RS bits; only probe them while INT/SQW is not outputting the square wave
+    Internal_DS3231_Control_t test = ctrl;
+    test.rs = DS3231_SquareWave_8192Hz;
+    test.conv = 0;
+    res = ds3231_set_ctrl(cfg, &test, timeout);
+    if (res == ESP_OK)
+      res = ds3231_get_ctrl(cfg, &test, timeout);
+    if (res == ESP_OK)
+    {
+      cfg->variant = test.rs == 0 ? DS3231_Variant_DS3231M : DS3231_Variant_DS3231;
+      ctrl.conv = 0;
+      res = ds3231_set_ctrl(cfg, &ctrl, timeout);
+    }
+  }
+  else
+  {
+    // either RS is non-zero, which the DS3231M cannot hold, or the square wave is in use and is left undisturbed
+    cfg->variant = DS3231_Variant_DS3231;
+  }
+
+  if (res == ESP_OK && variant)
+    *variant = cfg->variant;
   return res;
 }
 
+void ds3231_delete(DS3231_Cfg_t cfg)
+{
+  if (cfg)
+  {
+    ds3231_i2c_close(cfg);
+#if CONFIG_DS3231_TRACE
+    ds3231_trace_deinit(cfg);
+#endif
+#if CONFIG_DS3231_READ_CACHE
+    ds3231_cache_deinit(cfg);
+#endif
+    ds3231_port_lock_deinit(&cfg->kv_lock);
+    free(cfg->sram);
+    free(cfg);
+  }
+}
+
 static void ds3231_convert_ext_calendar(DS3231_Calendar_t* in, Internal_DS3231_Calendar_t* out)
 {
+  // bits without a field read back as 0 on the chip, so are written as 0
+  memset(out, 0, sizeof(*out));
   out->seconds_1s = in->seconds % 10;
   out->seconds_10s = in->seconds / 10;
   out->minutes_1s = in->minutes % 10;
@@ -467,6 +667,11 @@ static void ds3231_convert_ext_calendar(DS3231_Calendar_t* in, Internal_DS3231_C
       out->am_pm_hour_20 = 0;
       out->hour_10s = in->hour / 10;
     }
+    else
+    {
+      out->am_pm_hour_20 = 0;
+      out->hour_10s = 0;
+    }
   }
 
   out->day_of_week = in->day_of_week;
@@ -494,26 +699,27 @@ static void ds3231_convert_ext_calendar(DS3231_Calendar_t* in, Internal_DS3231_C
 
 static void ds3231_convert_int_calendar(DS3231_Calendar_t* out, Internal_DS3231_Calendar_t* in)
 {
-  out->seconds = in->seconds_10s * 10 + in->seconds_1s;
-  out->minutes = in->minutes_10s * 10 + in->minutes_1s;
-  if (in->mode_12_24h)
+  const uint8_t* raw = (const uint8_t*)in;
+  out->seconds = ds3231_raw_seconds(raw);
+  out->minutes = ds3231_raw_minutes(raw);
+  out->hour = ds3231_raw_hour(raw);
+  if (ds3231_raw_is_12h(raw))
   {
     out->clock_type = DS3231_ClockType_12_Hour;
-    out->hour = in->hour_10s * 10 + in->hour_1s;
-    out->am_pm = in->am_pm_hour_20 ? DS3231_PM : DS3231_AM;
+    out->am_pm = ds3231_raw_is_pm(raw) ? DS3231_PM : DS3231_AM;
   }
   else
   {
     out->clock_type = DS3231_ClockType_24_Hour;
-    out->hour = in->am_pm_hour_20 * 20 + in->hour_10s * 10 + in->hour_1s;
   }
 
-  out->day_of_week = in->day_of_week;
-  out->day_of_month = in->day_of_month_10s * 10 + in->day_of_month_1s;
-  out->month = in->month_10s * 10 + in->month_1s;
-  out->year = 2000 + in->century * 100 + in->year_10s * 10 + in->year_1s;
+  out->day_of_week = ds3231_raw_day_of_week(raw);
+  out->day_of_month = ds3231_raw_day_of_month(raw);
+  out->month = ds3231_raw_month(raw);
+  out->year = ds3231_raw_year(raw);
 }
 
+#if CONFIG_DS3231_ALARMS
 static esp_err_t ds3231_get_alarm1(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
 {
   Internal_DS3231_Alarm1_t alarm1;
@@ -547,7 +753,7 @@ static esp_err_t ds3231_get_alarm1(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alar
 static esp_err_t ds3231_get_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
 {
   Internal_DS3231_Alarm2_t alarm2;
-  esp_err_t res = ds3231_i2c_read(cfg, DS3231_ALM1_REG, (uint8_t*)&alarm2, sizeof(alarm2), timeout);
+  esp_err_t res = ds3231_i2c_read(cfg, DS3231_ALM2_REG, (uint8_t*)&alarm2, sizeof(alarm2), timeout);
   if (res == ESP_OK)
   {
     alarm->seconds = 0;
@@ -574,6 +780,20 @@ static esp_err_t ds3231_get_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alar
   return res;
 }
 static esp_err_t ds3231_set_alarm1(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
+{
+  Internal_DS3231_Alarm1_t alarm1;
+  ds3231_encode_alarm1(alarm, &alarm1);
+  return ds3231_i2c_write(cfg, DS3231_ALM1_REG, (uint8_t*)&alarm1, sizeof(alarm1), timeout);
+}
+
+static esp_err_t ds3231_set_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
+{
+  Internal_DS3231_Alarm2_t alarm2;
+  ds3231_encode_alarm2(alarm, &alarm2);
+  return ds3231_i2c_write(cfg, DS3231_ALM2_REG, (uint8_t*)&alarm2, sizeof(alarm2), timeout);
+}
+
+static void ds3231_encode_alarm1(const DS3231_AlarmSetting_t* alarm, Internal_DS3231_Alarm1_t* out)
 {
   Internal_DS3231_Alarm1_t alarm1;
 
@@ -586,40 +806,37 @@ static esp_err_t ds3231_set_alarm1(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alar
   alarm1.a1m2 = (alarm->alarm_rate & 0b0010) == 0b0010;
 
   alarm1.hour_1s = alarm->hour % 10;
+  alarm1.a1m3 = (alarm->alarm_rate & 0b0100) == 0b0100;
   if (alarm->clock_type == DS3231_ClockType_12_Hour)
   {
+    alarm1.mode_12_24h = 1;
     alarm1.hour_10s = alarm->hour / 10;
     alarm1.am_pm_hour_20 = alarm->am_pm == DS3231_PM;
   }
   else
   {
     alarm1.mode_12_24h = 0;
-    alarm1.a1m3 = (alarm->alarm_rate & 0b0100) == 0b0100;
     if (alarm->hour > 19)
     {
       alarm1.am_pm_hour_20 = 1;
       alarm1.hour_10s = 0;
     }
-    else if (alarm->hour > 9)
+    else
     {
       alarm1.am_pm_hour_20 = 0;
       alarm1.hour_10s = alarm->hour / 10;
     }
-    else
-    {
-      alarm1.hour_10s = 0;
-    }
   }
 
-  alarm1.day_of_week_or_month = alarm->day_type == DS3231_AlarmDayType_DayOfMonth;
+  alarm1.day_of_week_or_month = alarm->day_type == DS3231_AlarmDayType_DayOfWeek;
   alarm1.day_1s = alarm->day % 10;
-  alarm1.day_1s = alarm->day / 10;
+  alarm1.day_10s = alarm->day / 10;
   alarm1.a1m4 = (alarm->alarm_rate & 0b1000) == 0b1000;
 
-  return ds3231_i2c_write(cfg, DS3231_ALM1_REG, (uint8_t*)&alarm1, sizeof(alarm1), timeout);
+  *out = alarm1;
 }
 
-static esp_err_t ds3231_set_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout)
+static void ds3231_encode_alarm2(const DS3231_AlarmSetting_t* alarm, Internal_DS3231_Alarm2_t* out)
 {
   Internal_DS3231_Alarm2_t alarm2;
 
@@ -628,29 +845,26 @@ static esp_err_t ds3231_set_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alar
   alarm2.a2m2 = (alarm->alarm_rate & 0b001) == 0b001;
 
   alarm2.hour_1s = alarm->hour % 10;
+  alarm2.a2m3 = (alarm->alarm_rate & 0b010) == 0b010;
   if (alarm->clock_type == DS3231_ClockType_12_Hour)
   {
+    alarm2.mode_12_24h = 1;
     alarm2.hour_10s = alarm->hour / 10;
     alarm2.am_pm_hour_20 = alarm->am_pm == DS3231_PM;
   }
   else
   {
     alarm2.mode_12_24h = 0;
-    alarm2.a2m3 = (alarm->alarm_rate & 0b010) == 0b010;
     if (alarm->hour > 19) // 20-23
     {
       alarm2.am_pm_hour_20 = 1;
       alarm2.hour_10s = 0;
     }
-    else if (alarm->hour > 9) //10-19
+    else // 0-19
     {
       alarm2.am_pm_hour_20 = 0;
       alarm2.hour_10s = alarm->hour / 10;
     }
-    else // 1-9
-    {
-      alarm2.hour_10s = 0;
-    }
   }
 
   alarm2.day_of_week_or_month = alarm->day_type == DS3231_AlarmDayType_DayOfWeek;
@@ -658,5 +872,6 @@ static esp_err_t ds3231_set_alarm2(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alar
   alarm2.day_10s = alarm->day / 10;
   alarm2.a2m4 = (alarm->alarm_rate & 0b100) == 0b100;
 
-  return ds3231_i2c_write(cfg, DS3231_ALM2_REG, (uint8_t*)&alarm2, sizeof(alarm2), timeout);
-}
\ No newline at end of file
+  *out = alarm2;
+}
+#endif
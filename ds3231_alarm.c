@@ -0,0 +1,204 @@
+#include <ds3231_alarm.h>
+#include <ds3231_regs.h>
+#include <ds3231_time.h>
+
+#define DS3231_SECS_PER_MINUTE  60
+#define DS3231_SECS_PER_HOUR    3600
+#define DS3231_SECS_PER_DAY     86400
+#define DS3231_SECS_PER_WEEK    604800
+
+// Alarm 1 mask bits, A1M1-A1M4. Alarm 2 rates are converted to these with seconds fixed at 0.
+#define DS3231_MASK_SECONDS 0x01
+#define DS3231_MASK_MINUTES 0x02
+#define DS3231_MASK_HOURS   0x04
+#define DS3231_MASK_DAY     0x08
+
+static inline int64_t ds3231_floor_div(int64_t a, int64_t b)
+{
+  return a / b - (a % b < 0);
+}
+
+static inline int64_t ds3231_floor_mod(int64_t a, int64_t b)
+{
+  return a - ds3231_floor_div(a, b) * b;
+}
+
+static uint8_t ds3231_days_in_month(uint16_t year, uint8_t month)
+{
+  static const uint8_t days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+  bool leap = (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+  return days[month - 1] + (month == 2 && leap);
+}
+
+static bool ds3231_calendar_valid(const DS3231_Calendar_t* calendar)
+{
+  if (calendar->month < 1 || calendar->month > 12)
+    return false;
+  if (calendar->day_of_month < 1 || calendar->day_of_month > ds3231_days_in_month(calendar->year, calendar->month))
+    return false;
+  if (calendar->clock_type == DS3231_ClockType_12_Hour)
+  {
+    if (calendar->hour < 1 || calendar->hour > 12 || calendar->am_pm > DS3231_PM)
+      return false;
+  }
+  else if (calendar->clock_type != DS3231_ClockType_24_Hour || calendar->hour > 23)
+  {
+    return false;
+  }
+
+  return calendar->minutes <= 59 && calendar->seconds <= 59 && calendar->day_of_week >= 1 &&
+         calendar->day_of_week <= 7;
+}
+
+// The alarm 1 mask equivalent to the alarm's rate.
+static uint8_t ds3231_alarm_mask(const DS3231_AlarmSetting_t* alarm)
+{
+  if (alarm->alarm_type == DS3231_AlarmType_Alarm2)
+    return alarm->alarm_rate << 1;
+  return alarm->alarm_rate;
+}
+
+DS3231_AlarmError_t ds3231_alarm_validate(const DS3231_AlarmSetting_t* alarm)
+{
+  if (alarm->alarm_type == DS3231_AlarmType_Alarm1)
+  {
+    if (alarm->alarm_rate != DS3231_AlarmRate_PerSecond && alarm->alarm_rate != DS3231_AlarmRate_S_Match &&
+        alarm->alarm_rate != DS3231_AlarmRate_MS_Match && alarm->alarm_rate != DS3231_AlarmRate_HMS_Match &&
+        alarm->alarm_rate != DS3231_AlarmRate_DHMS_Match)
+      return DS3231_AlarmError_Rate;
+  }
+  else if (alarm->alarm_type == DS3231_AlarmType_Alarm2)
+  {
+    if (alarm->alarm_rate != DS3231_AlarmRate_PerMinute && alarm->alarm_rate != DS3231_AlarmRate_M_Match &&
+        alarm->alarm_rate != DS3231_AlarmRate_HM_Match && alarm->alarm_rate != DS3231_AlarmRate_DHM_Match)
+      return DS3231_AlarmError_Rate;
+    // alarm 2 has no seconds register, it always fires at second 0
+    if (alarm->seconds != 0)
+      return DS3231_AlarmError_Seconds;
+  }
+  else
+  {
+    return DS3231_AlarmError_Type;
+  }
+
+  // only the fields the rate compares are checked, the others are ignored by the chip and may be left at 0
+  const uint8_t mask = ds3231_alarm_mask(alarm);
+  if (!(mask & DS3231_MASK_SECONDS) && alarm->seconds > 59)
+    return DS3231_AlarmError_Seconds;
+  if (!(mask & DS3231_MASK_MINUTES) && alarm->minutes > 59)
+    return DS3231_AlarmError_Minutes;
+
+  if (!(mask & DS3231_MASK_HOURS))
+  {
+    if (alarm->clock_type == DS3231_ClockType_12_Hour)
+    {
+      if (alarm->am_pm != DS3231_AM && alarm->am_pm != DS3231_PM)
+        return DS3231_AlarmError_ClockType;
+      if (alarm->hour < 1 || alarm->hour > 12)
+        return DS3231_AlarmError_Hour;
+    }
+    else if (alarm->clock_type == DS3231_ClockType_24_Hour)
+    {
+      if (alarm->hour > 23)
+        return DS3231_AlarmError_Hour;
+    }
+    else
+    {
+      return DS3231_AlarmError_ClockType;
+    }
+  }
+
+  if (!(mask & DS3231_MASK_DAY))
+  {
+    if (alarm->day_type == DS3231_AlarmDayType_DayOfWeek)
+    {
+      if (alarm->day < 1 || alarm->day > 7)
+        return DS3231_AlarmError_Day;
+    }
+    else if (alarm->day_type == DS3231_AlarmDayType_DayOfMonth)
+    {
+      if (alarm->day < 1 || alarm->day > 31)
+        return DS3231_AlarmError_Day;
+    }
+    else
+    {
+      return DS3231_AlarmError_DayType;
+    }
+  }
+
+  return DS3231_AlarmError_None;
+}
+
+// The first time after t which is offset seconds into a period.
+static inline int64_t ds3231_next_in_period(int64_t t, int64_t period, int64_t offset)
+{
+  int64_t next = t - ds3231_floor_mod(t, period) + offset;
+  return next > t ? next : next + period;
+}
+
+// The first time after t on the given day of month, skipping months which are too short.
+static int64_t ds3231_next_day_of_month(int64_t t, uint8_t day, int64_t time_of_day)
+{
+  DS3231_Calendar_t calendar;
+  ds3231_epoch_to_calendar(t, &calendar);
+
+  uint16_t year = calendar.year;
+  uint8_t month = calendar.month;
+
+  // no more than two consecutive months are too short for any day 1-31, so this loops at most three times
+  while (1)
+  {
+    if (day <= ds3231_days_in_month(year, month))
+    {
+      int64_t next = (int64_t)ds3231_days_from_civil(year, month, day) * DS3231_SECS_PER_DAY + time_of_day;
+      if (next > t)
+        return next;
+    }
+
+    if (++month > 12)
+    {
+      month = 1;
+      year++;
+    }
+  }
+}
+
+DS3231_AlarmError_t ds3231_alarm_next(const DS3231_AlarmSetting_t* alarm, const DS3231_Calendar_t* now,
+                                      int64_t* fire, size_t count)
+{
+  DS3231_AlarmError_t err = ds3231_alarm_validate(alarm);
+  if (err != DS3231_AlarmError_None)
+    return err;
+  if (!ds3231_calendar_valid(now))
+    return DS3231_AlarmError_Calendar;
+
+  const uint8_t mask = ds3231_alarm_mask(alarm);
+  const int64_t hour = ds3231_hour24(alarm->clock_type, alarm->am_pm, alarm->hour);
+  const int64_t time_of_day = hour * DS3231_SECS_PER_HOUR + alarm->minutes * DS3231_SECS_PER_MINUTE + alarm->seconds;
+  const int64_t start = ds3231_calendar_to_epoch(now);
+
+  // epoch day on which the user defined day of week equals alarm->day; weeks repeat from there
+  const int64_t today = ds3231_floor_div(start, DS3231_SECS_PER_DAY);
+  const int64_t week_offset = (today + (alarm->day - now->day_of_week)) * DS3231_SECS_PER_DAY + time_of_day;
+
+  int64_t t = start;
+  for (size_t i = 0; i < count; i++)
+  {
+    if (mask & DS3231_MASK_SECONDS)
+      t = t + 1;
+    else if (mask & DS3231_MASK_MINUTES)
+      t = ds3231_next_in_period(t, DS3231_SECS_PER_MINUTE, alarm->seconds);
+    else if (mask & DS3231_MASK_HOURS)
+      t = ds3231_next_in_period(t, DS3231_SECS_PER_HOUR, alarm->minutes * DS3231_SECS_PER_MINUTE + alarm->seconds);
+    else if (mask & DS3231_MASK_DAY)
+      t = ds3231_next_in_period(t, DS3231_SECS_PER_DAY, time_of_day);
+    else if (alarm->day_type == DS3231_AlarmDayType_DayOfWeek)
+      t = ds3231_next_in_period(t, DS3231_SECS_PER_WEEK, ds3231_floor_mod(week_offset, DS3231_SECS_PER_WEEK));
+    else
+      t = ds3231_next_day_of_month(t, alarm->day, time_of_day);
+
+    fire[i] = t;
+  }
+
+  return DS3231_AlarmError_None;
+}
@@ -0,0 +1,65 @@
+#include <ds3231_batch.h>
+#include <string.h>
+
+#if !defined(DS3231_BATCH_SCALAR) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define DS3231_BATCH_SWAR 1
+#endif
+
+#ifdef DS3231_BATCH_SWAR
+
+// Register masks for seconds, minutes, hours (24h), day, date, month/century, year; byte n holds register n.
+#define DS3231_SWAR_MASK      0x00FF1F3F073F7F7FULL
+#define DS3231_SWAR_NIBBLES   0x000F0F0F0F0F0F0FULL
+
+static inline int64_t ds3231_swar_calendar_to_epoch(uint64_t x)
+{
+  const uint64_t is_12h = (x >> 22) & 1;
+  const uint64_t is_pm = (x >> 21) & is_12h;
+  const uint64_t century = (x >> 47) & 1;
+
+  // decode all seven BCD bytes at once; each byte is at most 15 + 15 * 10 so no lane carries into the next
+  // in 12-hour mode bit 5 of the hour is AM/PM rather than the 20 hour digit
+  const uint64_t masked = x & (DS3231_SWAR_MASK ^ (is_12h << 21));
+  const uint64_t lo = masked & DS3231_SWAR_NIBBLES;
+  const uint64_t hi = (masked >> 4) & DS3231_SWAR_NIBBLES;
+  const uint64_t bin = lo + (hi << 3) + (hi << 1);
+
+  const uint32_t seconds = bin & 0xFF;
+  const uint32_t minutes = (bin >> 8) & 0xFF;
+  uint32_t hour = (bin >> 16) & 0xFF;
+  const uint32_t day_of_month = (bin >> 32) & 0xFF;
+  const uint32_t month = (bin >> 40) & 0xFF;
+  const int32_t year = 2000 + (int32_t)century * 100 + (int32_t)((bin >> 48) & 0xFF);
+
+  // hour % 12 as ds3231_raw_hour24 does, so out-of-range images match too: 12 AM is hour 0, PM adds 12. The 12-hour
+  // register holds at most 25.
+  hour = hour - 12 * (is_12h * ((hour >= 12) + (hour >= 24))) + 12 * is_pm;
+
+  int64_t days = ds3231_days_from_civil(year, month, day_of_month);
+  return days * 86400 + hour * 3600 + minutes * 60 + seconds;
+}
+
+#endif // DS3231_BATCH_SWAR
+
+void ds3231_batch_calendar_to_epoch(const uint8_t* images, size_t stride, int64_t* epoch, size_t count)
+{
+  if (count == 0)
+    return;
+
+#ifdef DS3231_BATCH_SWAR
+  // every image but the last is followed by at least one more byte, so a full 8 byte load stays in bounds
+  for (size_t i = 0; i < count - 1; i++, images += stride)
+  {
+    uint64_t x;
+    memcpy(&x, images, sizeof(x));
+    epoch[i] = ds3231_swar_calendar_to_epoch(x & 0x00FFFFFFFFFFFFFFULL);
+  }
+
+  uint64_t x = 0;
+  memcpy(&x, images, DS3231_CAL_LEN);
+  epoch[count - 1] = ds3231_swar_calendar_to_epoch(x);
+#else
+  for (size_t i = 0; i < count; i++, images += stride)
+    epoch[i] = ds3231_raw_calendar_to_epoch(images);
+#endif
+}
@@ -0,0 +1,129 @@
+#include "ds3231_priv.h"
+#include <string.h>
+
+// The calendar changes every second and the temperature after each conversion, every 64s on the DS3231 and a multiple
+// of it on the DS3232. An image is reused until the next update the chip could make, found from a change seen between
+// two reads close together, widened by the drift between the DS3231 and the local timer.
+#define DS3231_CACHE_CAL_PERIOD_US  1000000
+#define DS3231_CACHE_TEMP_PERIOD_US 64000000
+#define DS3231_CACHE_DRIFT_PPM      100
+#define DS3231_CACHE_MARGIN_US      1000
+
+void ds3231_cache_init(DS3231_Cfg_t cfg)
+{
+  ds3231_port_lock_init(&cfg->cache_lock);
+}
+
+void ds3231_cache_deinit(DS3231_Cfg_t cfg)
+{
+  ds3231_port_lock_deinit(&cfg->cache_lock);
+}
+
+static int64_t ds3231_cache_margin(const DS3231_CacheLine_t* line, int64_t now_us)
+{
+  return DS3231_CACHE_MARGIN_US + (now_us - line->edge_hi_us) / (1000000 / DS3231_CACHE_DRIFT_PPM);
+}
+
+static int64_t ds3231_cache_div_ceil(int64_t num, int64_t den)
+{
+  return num > 0 ? (num + den - 1) / den : -(-num / den);
+}
+
+static void ds3231_cache_fill(DS3231_CacheLine_t* line, int64_t period_us, const uint8_t* regs, size_t len,
+                              int64_t start_us, int64_t end_us)
+{
+  // a change since the previous read puts an update between the two; keep the narrowest estimate, allowing for drift
+  if (line->valid && memcmp(line->regs, regs, len) != 0)
+  {
+    int64_t width = end_us - line->read_start_us;
+    if (width <= period_us / 10 &&
+        (!line->edge_known ||
+         width <= line->edge_hi_us - line->edge_lo_us + 2 * ds3231_cache_margin(line, start_us)))
+    {
+      line->edge_known = true;
+      line->edge_lo_us = line->read_start_us;
+      line->edge_hi_us = end_us;
+    }
+  }
+
+  memcpy(line->regs, regs, len);
+  line->valid = true;
+  line->read_start_us = start_us;
+  line->read_end_us = end_us;
+  line->expires_us = start_us;
+  if (line->edge_known)
+  {
+    // updates fall in [edge_lo_us, edge_hi_us] plus whole periods, widened by margin; if the read started inside
+    // such a window the image may already be out of date and is not reused
+    int64_t margin = ds3231_cache_margin(line, start_us);
+    int64_t k = ds3231_cache_div_ceil(start_us - line->edge_hi_us - margin, period_us);
+    int64_t next = line->edge_lo_us + k * period_us - margin;
+    if (next > start_us)
+      line->expires_us = next;
+  }
+}
+
+esp_err_t ds3231_cache_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  DS3231_CacheLine_t* line;
+  int64_t period_us;
+  if (reg == DS3231_CAL_REG && data_len == DS3231_CAL_LEN)
+  {
+    line = &cfg->cache_cal;
+    period_us = DS3231_CACHE_CAL_PERIOD_US;
+  }
+  else if (reg == DS3231_TEMP_REG && data_len == DS3231_TEMP_LEN && cfg->variant != DS3231_Variant_DS3231M)
+  {
+    // the DS3231M converts on its own schedule
+    line = &cfg->cache_temp;
+    period_us = DS3231_CACHE_TEMP_PERIOD_US;
+  }
+  else
+  {
+    return ds3231_i2c_read(cfg, reg, data, data_len, timeout);
+  }
+
+  int64_t entry_us = ds3231_port_time_us();
+  if (!ds3231_port_lock(&cfg->cache_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  // a read which finished after this call started is as good as a new one, so callers waiting on the lock while
+  // another task reads share its result
+  esp_err_t res = ESP_OK;
+  int64_t start_us = ds3231_port_time_us();
+  if (!line->valid || (line->read_end_us < entry_us && start_us >= line->expires_us))
+  {
+    uint8_t regs[DS3231_CAL_LEN];
+    res = ds3231_i2c_read(cfg, reg, regs, data_len, timeout);
+    if (res == ESP_OK)
+      ds3231_cache_fill(line, period_us, regs, data_len, start_us, ds3231_port_time_us());
+  }
+
+  if (res == ESP_OK)
+    memcpy(data, line->regs, data_len);
+  ds3231_port_unlock(&cfg->cache_lock);
+  return res;
+}
+
+void ds3231_cache_invalidate(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len)
+{
+  // writing the seconds restarts the countdown chain and a conversion started with CONV is off the 64s schedule, so
+  // what was learned goes too
+  if (reg < DS3231_CAL_REG + DS3231_CAL_LEN)
+    memset(&cfg->cache_cal, 0, sizeof(cfg->cache_cal));
+  if (reg <= DS3231_CTRL_REG && reg + data_len > DS3231_CTRL_REG && (data[DS3231_CTRL_REG - reg] & DS3231_CTRL_CONV))
+    memset(&cfg->cache_temp, 0, sizeof(cfg->cache_temp));
+}
+
+esp_err_t ds3231_cache_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  if (!ds3231_port_lock(&cfg->cache_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  // invalidate even if the write fails, part of it may have reached the chip
+  esp_err_t res = ds3231_i2c_transfer_write(cfg, reg, data, data_len, timeout);
+  ds3231_cache_invalidate(cfg, reg, data, data_len);
+
+  ds3231_port_unlock(&cfg->cache_lock);
+  return res;
+}
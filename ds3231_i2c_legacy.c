@@ -0,0 +1,61 @@
+#include "ds3231_priv.h"
+
+#if CONFIG_DS3231_I2C_BACKEND_LEGACY
+
+esp_err_t ds3231_i2c_open(DS3231_Cfg_t cfg)
+{
+  i2c_cmd_handle_t i2c_cmd_handle = i2c_cmd_link_create();
+  i2c_master_start(i2c_cmd_handle);
+  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_WRITE, true);
+  i2c_master_stop(i2c_cmd_handle);
+  esp_err_t res = i2c_master_cmd_begin(cfg->i2c_port, i2c_cmd_handle, pdMS_TO_TICKS(1));
+  i2c_cmd_link_delete(i2c_cmd_handle);
+
+  return res;
+}
+
+void ds3231_i2c_close(DS3231_Cfg_t cfg)
+{
+  // the i2c driver is installed and owned by the application
+}
+
+esp_err_t ds3231_i2c_bus_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  i2c_cmd_handle_t i2c_cmd_handle = i2c_cmd_link_create();
+  i2c_master_start(i2c_cmd_handle);
+  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_WRITE, true);
+  i2c_master_write_byte(i2c_cmd_handle, reg, true);
+  i2c_master_start(i2c_cmd_handle);
+  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_READ, true);
+  i2c_master_read(i2c_cmd_handle, data, data_len, I2C_MASTER_LAST_NACK);
+  i2c_master_stop(i2c_cmd_handle);
+  esp_err_t res = i2c_master_cmd_begin(cfg->i2c_port, i2c_cmd_handle, timeout);
+  i2c_cmd_link_delete(i2c_cmd_handle);
+
+  return res;
+}
+
+esp_err_t ds3231_i2c_bus_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  i2c_cmd_handle_t i2c_cmd_handle = i2c_cmd_link_create();
+  i2c_master_start(i2c_cmd_handle);
+  i2c_master_write_byte(i2c_cmd_handle, (DS3231_ADDR << 1) | I2C_MASTER_WRITE, true);
+  i2c_master_write_byte(i2c_cmd_handle, reg, true);
+  i2c_master_write(i2c_cmd_handle, data, data_len, true);
+  i2c_master_stop(i2c_cmd_handle);
+  esp_err_t res = i2c_master_cmd_begin(cfg->i2c_port, i2c_cmd_handle, timeout);
+  i2c_cmd_link_delete(i2c_cmd_handle);
+
+  return res;
+}
+
+esp_err_t ds3231_i2c_set_clk_speed(DS3231_Cfg_t cfg, uint32_t clk_speed, TickType_t timeout)
+{
+  (void)cfg;
+  (void)clk_speed;
+  (void)timeout;
+  // the bus timing belongs to the application's i2c_config_t, see DS3231_LinkTuneCfg_t.set_clk_speed
+  return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_DS3231_I2C_BACKEND_LEGACY
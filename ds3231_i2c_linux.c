@@ -0,0 +1,167 @@
+#include "ds3231_priv.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+static esp_err_t ds3231_errno_to_esp_err(int err)
+{
+  switch (err)
+  {
+    case ETIMEDOUT:
+      return ESP_ERR_TIMEOUT;
+    case ENOMEM:
+      return ESP_ERR_NO_MEM;
+    case EINVAL:
+      return ESP_ERR_INVALID_ARG;
+    case EOPNOTSUPP:
+      return ESP_ERR_NOT_SUPPORTED;
+    default:
+      // includes ENXIO and EREMOTEIO when the DS3231 does not acknowledge
+      return ESP_FAIL;
+  }
+}
+
+esp_err_t ds3231_i2c_open(DS3231_Cfg_t cfg)
+{
+  char path[32];
+  snprintf(path, sizeof(path), "/dev/i2c-%d", cfg->i2c_port);
+  cfg->fd = open(path, O_RDWR | O_CLOEXEC);
+  if (cfg->fd < 0)
+    return ESP_ERR_NOT_FOUND;
+
+  unsigned long funcs = 0;
+  esp_err_t res = ESP_OK;
+  if (ioctl(cfg->fd, I2C_FUNCS, &funcs) < 0)
+  {
+    res = ds3231_errno_to_esp_err(errno);
+  }
+  else if (funcs & I2C_FUNC_I2C)
+  {
+    cfg->smbus = false;
+  }
+  else if ((funcs & I2C_FUNC_SMBUS_I2C_BLOCK) == I2C_FUNC_SMBUS_I2C_BLOCK)
+  {
+    // SMBus transfers address the device set with I2C_SLAVE
+    cfg->smbus = true;
+    if (ioctl(cfg->fd, I2C_SLAVE, DS3231_ADDR) < 0)
+      res = ds3231_errno_to_esp_err(errno);
+  }
+  else
+  {
+    res = ESP_ERR_NOT_SUPPORTED;
+  }
+
+  if (res == ESP_OK)
+  {
+    uint8_t seconds;
+    res = ds3231_i2c_read(cfg, DS3231_CAL_REG, &seconds, sizeof(seconds), pdMS_TO_TICKS(10));
+  }
+
+  if (res != ESP_OK)
+  {
+    close(cfg->fd);
+    cfg->fd = -1;
+  }
+
+  return res;
+}
+
+void ds3231_i2c_close(DS3231_Cfg_t cfg)
+{
+  if (cfg->fd >= 0)
+    close(cfg->fd);
+}
+
+static esp_err_t ds3231_smbus_block(DS3231_Cfg_t cfg, char read_write, uint8_t reg, uint8_t* data, size_t data_len)
+{
+  union i2c_smbus_data block;
+  struct i2c_smbus_ioctl_data args =
+  {
+    .read_write = read_write,
+    .command = reg,
+    .size = I2C_SMBUS_I2C_BLOCK_DATA,
+    .data = &block,
+  };
+
+  block.block[0] = data_len;
+  if (read_write == I2C_SMBUS_WRITE)
+    memcpy(&block.block[1], data, data_len);
+
+  if (ioctl(cfg->fd, I2C_SMBUS, &args) < 0)
+    return ds3231_errno_to_esp_err(errno);
+
+  if (read_write == I2C_SMBUS_READ)
+    memcpy(data, &block.block[1], data_len);
+  return ESP_OK;
+}
+
+// longer bursts, e.g. DS3232 SRAM, are split into blocks; the calendar and temperature fit in one
+static esp_err_t ds3231_smbus_blocks(DS3231_Cfg_t cfg, char read_write, uint8_t reg, uint8_t* data, size_t data_len)
+{
+  esp_err_t res = ESP_OK;
+  for (size_t done = 0; done < data_len && res == ESP_OK; done += I2C_SMBUS_BLOCK_MAX)
+  {
+    size_t len = data_len - done < I2C_SMBUS_BLOCK_MAX ? data_len - done : I2C_SMBUS_BLOCK_MAX;
+    res = ds3231_smbus_block(cfg, read_write, reg + done, data + done, len);
+  }
+
+  return res;
+}
+
+// I2C_TIMEOUT sets the timeout of the whole adapter, shared with every other user of the bus, and cannot be read back
+// to restore it, so the adapter driver's timeout is used and the timeout argument is ignored.
+esp_err_t ds3231_i2c_bus_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  (void)timeout;
+
+  if (cfg->smbus)
+    return ds3231_smbus_blocks(cfg, I2C_SMBUS_READ, reg, data, data_len);
+
+  // register address write and data read as one combined transaction with a repeated start
+  struct i2c_msg msgs[2] =
+  {
+    { .addr = DS3231_ADDR, .flags = 0, .len = 1, .buf = &reg },
+    { .addr = DS3231_ADDR, .flags = I2C_M_RD, .len = data_len, .buf = data },
+  };
+  struct i2c_rdwr_ioctl_data rdwr = { .msgs = msgs, .nmsgs = 2 };
+
+  if (ioctl(cfg->fd, I2C_RDWR, &rdwr) < 0)
+    return ds3231_errno_to_esp_err(errno);
+  return ESP_OK;
+}
+
+esp_err_t ds3231_i2c_bus_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  (void)timeout;
+
+  if (cfg->smbus)
+    return ds3231_smbus_blocks(cfg, I2C_SMBUS_WRITE, reg, (uint8_t*)data, data_len);
+
+  uint8_t buf[DS3231_I2C_MAX_WRITE];
+  if (data_len > sizeof(buf) - 1)
+    return ESP_ERR_INVALID_SIZE;
+
+  buf[0] = reg;
+  memcpy(&buf[1], data, data_len);
+
+  struct i2c_msg msg = { .addr = DS3231_ADDR, .flags = 0, .len = data_len + 1, .buf = buf };
+  struct i2c_rdwr_ioctl_data rdwr = { .msgs = &msg, .nmsgs = 1 };
+
+  if (ioctl(cfg->fd, I2C_RDWR, &rdwr) < 0)
+    return ds3231_errno_to_esp_err(errno);
+  return ESP_OK;
+}
+
+esp_err_t ds3231_i2c_set_clk_speed(DS3231_Cfg_t cfg, uint32_t clk_speed, TickType_t timeout)
+{
+  (void)cfg;
+  (void)clk_speed;
+  (void)timeout;
+  // the bus speed is fixed by the kernel adapter driver, e.g. clock-frequency in the device tree
+  return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,349 @@
+#include "ds3231_priv.h"
+
+#if CONFIG_DS3231_I2C_BACKEND_MASTER
+#include <esp_attr.h>
+#include <stdlib.h>
+#include <string.h>
+
+static inline int ds3231_i2c_timeout_ms(TickType_t timeout)
+{
+  return timeout == portMAX_DELAY ? -1 : (int)pdTICKS_TO_MS(timeout);
+}
+
+// Transfers on the device complete in the order they were queued, so each is identified by the count of completions.
+static inline bool ds3231_i2c_done(DS3231_Cfg_t cfg, uint32_t seq)
+{
+  return (int32_t)(cfg->completed - seq) >= 0;
+}
+
+static bool IRAM_ATTR ds3231_i2c_trans_done(i2c_master_dev_handle_t dev, const i2c_master_event_data_t* event,
+                                            void* arg)
+{
+  DS3231_Cfg_t cfg = arg;
+  esp_err_t res = event->event == I2C_EVENT_DONE ? ESP_OK : ESP_FAIL;
+  uint32_t seq = cfg->completed + 1;
+
+  if (seq == cfg->sync_seq)
+    cfg->sync_res = res;
+  cfg->completed = seq;
+
+  if (cfg->async_busy && seq == cfg->async_seq)
+  {
+    DS3231_AsyncCb_t cb = cfg->async_cb;
+    cfg->async_busy = false;
+    cb(cfg->async_arg, res);
+  }
+
+  return false;
+}
+
+static esp_err_t ds3231_i2c_add_device(DS3231_Cfg_t cfg)
+{
+  i2c_device_config_t dev_cfg = {
+    .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+    .device_address = DS3231_ADDR,
+    .scl_speed_hz = cfg->scl_speed_hz,
+  };
+  esp_err_t res = i2c_master_bus_add_device(cfg->bus, &dev_cfg, &cfg->dev);
+  if (res != ESP_OK || !cfg->async)
+    return res;
+
+  // leave no device behind without the callbacks that count its transfers
+  i2c_master_event_callbacks_t cbs = { .on_trans_done = ds3231_i2c_trans_done };
+  res = i2c_master_register_event_callbacks(cfg->dev, &cbs, cfg);
+  if (res != ESP_OK)
+  {
+    i2c_master_bus_rm_device(cfg->dev);
+    cfg->dev = NULL;
+  }
+  return res;
+}
+
+// Called with bus_lock held.
+static esp_err_t ds3231_i2c_enable_async(DS3231_Cfg_t cfg)
+{
+  if (cfg->async)
+    return ESP_OK;
+
+  // the i2c driver refuses callbacks with ESP_ERR_INVALID_STATE when the bus has no transaction queue
+  i2c_master_event_callbacks_t cbs = { .on_trans_done = ds3231_i2c_trans_done };
+  esp_err_t res = i2c_master_register_event_callbacks(cfg->dev, &cbs, cfg);
+  if (res == ESP_ERR_INVALID_STATE)
+    return ESP_ERR_NOT_SUPPORTED;
+  if (res == ESP_OK)
+    cfg->async = true;
+  return res;
+}
+
+// Take bus_lock for a synchronous transfer. With callbacks registered, transfers are only queued, and one whose wait
+// timed out still owns sync_buf; it must have completed before sync_buf is used again.
+static esp_err_t ds3231_i2c_sync_begin(DS3231_Cfg_t cfg, TickType_t timeout)
+{
+  if (!ds3231_port_lock(&cfg->bus_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  // the device is gone if it could not be re-added at any speed, see ds3231_i2c_set_clk_speed
+  if (!cfg->dev)
+  {
+    ds3231_port_unlock(&cfg->bus_lock);
+    return ESP_ERR_INVALID_STATE;
+  }
+
+  if (cfg->async && !ds3231_i2c_done(cfg, cfg->sync_seq))
+  {
+    i2c_master_bus_wait_all_done(cfg->bus, ds3231_i2c_timeout_ms(timeout));
+    if (!ds3231_i2c_done(cfg, cfg->sync_seq))
+    {
+      ds3231_port_unlock(&cfg->bus_lock);
+      return ESP_ERR_TIMEOUT;
+    }
+  }
+
+  return ESP_OK;
+}
+
+// Wait for the synchronous transfer just queued. On timeout it stays queued on sync_buf.
+static esp_err_t ds3231_i2c_sync_wait(DS3231_Cfg_t cfg, TickType_t timeout)
+{
+  esp_err_t res = i2c_master_bus_wait_all_done(cfg->bus, ds3231_i2c_timeout_ms(timeout));
+  if (!ds3231_i2c_done(cfg, cfg->sync_seq))
+    return res == ESP_OK ? ESP_ERR_TIMEOUT : res;
+  return cfg->sync_res;
+}
+
+DS3231_Cfg_t ds3231_create_from_bus(i2c_master_bus_handle_t bus)
+{
+  DS3231_Cfg_t cfg = (DS3231_Cfg_t)calloc(1, sizeof(*cfg));
+  if (!cfg)
+    return NULL;
+
+  cfg->i2c_port = -1;
+  cfg->bus = bus;
+  esp_err_t res = ds3231_i2c_open(cfg);
+  if (res != ESP_OK)
+  {
+    free(cfg);
+    return NULL;
+  }
+
+#if CONFIG_DS3231_TRACE
+  ds3231_trace_init(cfg);
+#endif
+#if CONFIG_DS3231_READ_CACHE
+  ds3231_cache_init(cfg);
+#endif
+
+  return cfg;
+}
+
+esp_err_t ds3231_i2c_open(DS3231_Cfg_t cfg)
+{
+  esp_err_t res;
+  if (!cfg->bus)
+  {
+    // the bus is created and owned by the application
+    res = i2c_master_get_bus_handle(cfg->i2c_port, &cfg->bus);
+    if (res != ESP_OK)
+      return res;
+  }
+
+  res = i2c_master_probe(cfg->bus, DS3231_ADDR, ds3231_i2c_timeout_ms(pdMS_TO_TICKS(10)));
+  if (res != ESP_OK)
+    return res;
+
+  cfg->scl_speed_hz = CONFIG_DS3231_I2C_MASTER_SCL_SPEED_HZ;
+  res = ds3231_i2c_add_device(cfg);
+  if (res == ESP_OK)
+    ds3231_port_lock_init(&cfg->bus_lock);
+  return res;
+}
+
+void ds3231_i2c_close(DS3231_Cfg_t cfg)
+{
+  // queued transfers may still use sync_buf, async_buf or the callback argument
+  if (cfg->async)
+    i2c_master_bus_wait_all_done(cfg->bus, -1);
+  if (cfg->dev)
+    i2c_master_bus_rm_device(cfg->dev);
+  ds3231_port_lock_deinit(&cfg->bus_lock);
+}
+
+esp_err_t ds3231_i2c_bus_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  if (data_len > sizeof(cfg->sync_buf))
+    return ESP_ERR_INVALID_SIZE;
+
+  esp_err_t res = ds3231_i2c_sync_begin(cfg, timeout);
+  if (res != ESP_OK)
+    return res;
+
+  cfg->sync_reg = reg;
+  if (!cfg->async)
+  {
+    // without callbacks the transfer has finished, or been abandoned by the driver, when transmit returns
+    res = i2c_master_transmit_receive(cfg->dev, &cfg->sync_reg, 1, data, data_len, ds3231_i2c_timeout_ms(timeout));
+  }
+  else
+  {
+    cfg->sync_seq = ++cfg->queued;
+    res = i2c_master_transmit_receive(cfg->dev, &cfg->sync_reg, 1, cfg->sync_buf, data_len,
+                                      ds3231_i2c_timeout_ms(timeout));
+    if (res == ESP_OK)
+      res = ds3231_i2c_sync_wait(cfg, timeout);
+    else
+      cfg->sync_seq = --cfg->queued;
+    if (res == ESP_OK)
+      memcpy(data, cfg->sync_buf, data_len);
+  }
+
+  ds3231_port_unlock(&cfg->bus_lock);
+  return res;
+}
+
+esp_err_t ds3231_i2c_bus_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  if (data_len > sizeof(cfg->sync_buf) - 1)
+    return ESP_ERR_INVALID_SIZE;
+
+  esp_err_t res = ds3231_i2c_sync_begin(cfg, timeout);
+  if (res != ESP_OK)
+    return res;
+
+  cfg->sync_buf[0] = reg;
+  memcpy(&cfg->sync_buf[1], data, data_len);
+  if (cfg->async)
+    cfg->sync_seq = ++cfg->queued;
+  res = i2c_master_transmit(cfg->dev, cfg->sync_buf, data_len + 1, ds3231_i2c_timeout_ms(timeout));
+  if (cfg->async)
+  {
+    if (res == ESP_OK)
+      res = ds3231_i2c_sync_wait(cfg, timeout);
+    else
+      cfg->sync_seq = --cfg->queued;
+  }
+
+  ds3231_port_unlock(&cfg->bus_lock);
+  return res;
+}
+
+esp_err_t ds3231_i2c_set_clk_speed(DS3231_Cfg_t cfg, uint32_t clk_speed, TickType_t timeout)
+{
+  if (!ds3231_port_lock(&cfg->bus_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  // queued transfers use the device being removed
+  esp_err_t res = ESP_OK;
+  if (cfg->async)
+    res = i2c_master_bus_wait_all_done(cfg->bus, ds3231_i2c_timeout_ms(timeout));
+  if (res != ESP_OK)
+  {
+    ds3231_port_unlock(&cfg->bus_lock);
+    return res;
+  }
+
+  // the device speed is fixed when it is added to the bus; a device lost by an earlier failure is only added
+  if (cfg->dev)
+    res = i2c_master_bus_rm_device(cfg->dev);
+  if (res == ESP_OK)
+  {
+    cfg->dev = NULL;
+    const uint32_t prev_speed_hz = cfg->scl_speed_hz;
+    cfg->scl_speed_hz = clk_speed;
+    res = ds3231_i2c_add_device(cfg);
+    if (res != ESP_OK)
+    {
+      // keep the device usable at the speed it had; if that fails too, transfers return ESP_ERR_INVALID_STATE
+      cfg->dev = NULL;
+      cfg->scl_speed_hz = prev_speed_hz;
+      if (ds3231_i2c_add_device(cfg) != ESP_OK)
+        cfg->dev = NULL;
+    }
+  }
+
+  ds3231_port_unlock(&cfg->bus_lock);
+  return res;
+}
+
+// Claim the asynchronous transfer slot. On success bus_lock is held until the transfer has been queued. Asynchronous
+// transfers do not wait for a synchronous one holding the lock.
+static esp_err_t ds3231_i2c_async_begin(DS3231_Cfg_t cfg, DS3231_AsyncCb_t cb, void* arg)
+{
+  if (!ds3231_port_lock(&cfg->bus_lock, 0))
+    return ESP_ERR_TIMEOUT;
+
+  esp_err_t res = ESP_ERR_INVALID_STATE;
+  if (cfg->dev && !cfg->async_busy)
+    res = ds3231_i2c_enable_async(cfg);
+  if (res != ESP_OK)
+  {
+    ds3231_port_unlock(&cfg->bus_lock);
+    return res;
+  }
+
+  cfg->async_cb = cb;
+  cfg->async_arg = arg;
+  cfg->async_seq = ++cfg->queued;
+  cfg->async_busy = true;
+  return ESP_OK;
+}
+
+static esp_err_t ds3231_i2c_async_end(DS3231_Cfg_t cfg, esp_err_t res)
+{
+  if (res != ESP_OK)
+  {
+    cfg->async_busy = false;
+    cfg->async_seq = --cfg->queued;
+  }
+
+  ds3231_port_unlock(&cfg->bus_lock);
+  return res;
+}
+
+esp_err_t ds3231_read_raw_async(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, DS3231_AsyncCb_t cb,
+                                void* arg)
+{
+  if (!data || data_len == 0 || !cb)
+    return ESP_ERR_INVALID_ARG;
+  if (reg + data_len > ds3231_reg_count(cfg))
+    return ESP_ERR_INVALID_SIZE;
+
+  esp_err_t res = ds3231_i2c_async_begin(cfg, cb, arg);
+  if (res != ESP_OK)
+    return res;
+
+  cfg->async_buf[0] = reg;
+  res = i2c_master_transmit_receive(cfg->dev, cfg->async_buf, 1, data, data_len, -1);
+  return ds3231_i2c_async_end(cfg, res);
+}
+
+esp_err_t ds3231_write_raw_async(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len,
+                                 DS3231_AsyncCb_t cb, void* arg)
+{
+  if (!data || data_len == 0 || !cb)
+    return ESP_ERR_INVALID_ARG;
+  if (reg + data_len > ds3231_reg_count(cfg) || data_len > sizeof(cfg->async_buf) - 1)
+    return ESP_ERR_INVALID_SIZE;
+
+#if CONFIG_DS3231_READ_CACHE
+  // cached reads made after this are queued behind the write, so invalidating now is enough
+  if (!ds3231_port_lock(&cfg->cache_lock, 0))
+    return ESP_ERR_TIMEOUT;
+#endif
+  esp_err_t res = ds3231_i2c_async_begin(cfg, cb, arg);
+  if (res == ESP_OK)
+  {
+    cfg->async_buf[0] = reg;
+    memcpy(&cfg->async_buf[1], data, data_len);
+    res = i2c_master_transmit(cfg->dev, cfg->async_buf, data_len + 1, -1);
+    res = ds3231_i2c_async_end(cfg, res);
+  }
+#if CONFIG_DS3231_READ_CACHE
+  if (res == ESP_OK)
+    ds3231_cache_invalidate(cfg, reg, data, data_len);
+  ds3231_port_unlock(&cfg->cache_lock);
+#endif
+
+  return res;
+}
+
+#endif // CONFIG_DS3231_I2C_BACKEND_MASTER
@@ -0,0 +1,113 @@
+#include "ds3231_priv.h"
+#include <ds3231_sim.h>
+#include <stdint.h>
+#include <string.h>
+
+#define DS3231_CTRL_RS_MASK  0x18
+#define DS3231_CS_OSF        0x80
+#define DS3232_CS_BB32KHZ    0x40
+#define DS3231_CS_EN32KHZ    0x08
+#define DS3231_CS_FLAGS      (DS3231_CS_OSF | 0x03)  // OSF, A2F and A1F, cleared by writing 0
+
+static size_t ds3231_sim_reg_count(DS3231_Cfg_t cfg)
+{
+  return cfg->sim_variant == DS3231_Variant_DS3232 ? DS3232_REG_COUNT : DS3231_REG_COUNT;
+}
+
+esp_err_t ds3231_i2c_open(DS3231_Cfg_t cfg)
+{
+  // power-on state: 01/01/2000, INTCN and RS set, oscillator stop flag and 32kHz output set, 25 degrees
+  memset(cfg->sim_regs, 0, sizeof(cfg->sim_regs));
+  cfg->sim_regs[DS3231_CAL_REG + 3] = 0x01;
+  cfg->sim_regs[DS3231_CAL_REG + 4] = 0x01;
+  cfg->sim_regs[DS3231_CAL_REG + 5] = 0x01;
+  cfg->sim_regs[DS3231_CTRL_REG] = 0x1C;
+  cfg->sim_regs[DS3231_CS_REG] = DS3231_CS_OSF | DS3231_CS_EN32KHZ;
+  cfg->sim_regs[DS3231_TEMP_REG] = 25;
+  cfg->sim_variant = DS3231_Variant_DS3231;
+  cfg->sim_write_budget = SIZE_MAX;
+  return ESP_OK;
+}
+
+void ds3231_i2c_close(DS3231_Cfg_t cfg)
+{
+  (void)cfg;
+}
+
+esp_err_t ds3231_i2c_bus_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  (void)timeout;
+  // the register pointer wraps at the end of the register map, as on the chip
+  size_t count = ds3231_sim_reg_count(cfg);
+  for (size_t i = 0; i < data_len; i++)
+    data[i] = cfg->sim_regs[(reg + i) % count];
+  return ESP_OK;
+}
+
+static void ds3231_sim_write_reg(DS3231_Cfg_t cfg, size_t reg, uint8_t value)
+{
+  uint8_t* regs = cfg->sim_regs;
+  switch (reg)
+  {
+    case DS3231_CTRL_REG:
+      if (cfg->sim_variant == DS3231_Variant_DS3231M)
+        value &= ~DS3231_CTRL_RS_MASK;
+      regs[reg] = value & ~DS3231_CTRL_CONV;
+      break;
+    case DS3231_CS_REG:
+    {
+      uint8_t writable = DS3231_CS_EN32KHZ;
+      if (cfg->sim_variant == DS3231_Variant_DS3232)
+        writable |= DS3232_CS_BB32KHZ | DS3232_CS_CRATE;
+      regs[reg] = ((regs[reg] & ~writable) | (value & writable)) & ~(DS3231_CS_FLAGS & ~value);
+      break;
+    }
+    case DS3231_TEMP_REG:
+    case DS3231_TEMP_REG + 1:
+      break;
+    default:
+      regs[reg] = value;
+      break;
+  }
+}
+
+esp_err_t ds3231_i2c_bus_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  (void)timeout;
+  if (data_len > DS3231_I2C_MAX_WRITE - 1)
+    return ESP_ERR_INVALID_SIZE;
+
+  size_t count = ds3231_sim_reg_count(cfg);
+  for (size_t i = 0; i < data_len; i++)
+  {
+    if (cfg->sim_write_budget == 0)
+      return ESP_FAIL;
+    if (cfg->sim_write_budget != SIZE_MAX)
+      cfg->sim_write_budget--;
+    ds3231_sim_write_reg(cfg, (reg + i) % count, data[i]);
+  }
+  return ESP_OK;
+}
+
+esp_err_t ds3231_i2c_set_clk_speed(DS3231_Cfg_t cfg, uint32_t clk_speed, TickType_t timeout)
+{
+  (void)cfg;
+  (void)clk_speed;
+  (void)timeout;
+  return ESP_OK;
+}
+
+void ds3231_sim_set_variant(DS3231_Cfg_t cfg, DS3231_Variant_t variant)
+{
+  cfg->sim_variant = variant;
+}
+
+void ds3231_sim_fail_writes_after(DS3231_Cfg_t cfg, size_t bytes)
+{
+  cfg->sim_write_budget = bytes;
+}
+
+uint8_t* ds3231_sim_regs(DS3231_Cfg_t cfg)
+{
+  return cfg->sim_regs;
+}
@@ -0,0 +1,309 @@
+#include "ds3231_priv.h"
+#include <ds3231_kv.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t ds3231_kv_crc8(const uint8_t* data, size_t len)
+{
+  uint8_t crc = 0xFF;
+  while (len--)
+  {
+    crc ^= *data++;
+    for (int bit = 0; bit < 8; bit++)
+      crc = crc & 0x80 ? (crc << 1) ^ 0x31 : crc << 1;
+  }
+
+  return crc;
+}
+
+#define DS3231_KV_MAGIC   0xD3
+#define DS3231_KV_VERSION 1
+
+static inline size_t ds3231_kv_record_len(const uint8_t* record)
+{
+  return record[1] + DS3231_KV_OVERHEAD;
+}
+
+// The unused part of a bank reads as end markers, so a record cut off before its CRC has 0xFF there, which is never
+// used as a CRC.
+static uint8_t ds3231_kv_record_crc(const uint8_t* record)
+{
+  const uint8_t crc = ds3231_kv_crc8(record, record[1] + 2);
+  return crc == DS3231_KV_END ? 0 : crc;
+}
+
+static bool ds3231_kv_header_valid(const uint8_t* bank)
+{
+  return bank[0] == DS3231_KV_MAGIC && bank[1] == DS3231_KV_VERSION &&
+         ds3231_kv_crc8(bank, DS3231_KV_HEADER_LEN - 1) == bank[DS3231_KV_HEADER_LEN - 1];
+}
+
+// Offset just past the last intact record of the bank at base; the end marker normally sits there.
+static size_t ds3231_kv_scan(const uint8_t* sram, size_t base)
+{
+  const size_t limit = base + DS3231_KV_BANK_LEN;
+  size_t pos = base + DS3231_KV_HEADER_LEN;
+  while (pos + DS3231_KV_OVERHEAD < limit && sram[pos] != DS3231_KV_END)
+  {
+    const size_t len = sram[pos + 1];
+    if (pos + len + DS3231_KV_OVERHEAD >= limit)
+      break;
+    if (ds3231_kv_record_crc(&sram[pos]) != sram[pos + len + 2])
+      break;
+    pos += len + DS3231_KV_OVERHEAD;
+  }
+
+  return pos;
+}
+
+// Offset of the newest record for key, or -1.
+static int ds3231_kv_find(DS3231_Cfg_t cfg, uint8_t key, size_t from)
+{
+  int found = -1;
+  for (size_t pos = from; pos < cfg->sram_end; pos += ds3231_kv_record_len(&cfg->sram[pos]))
+  {
+    if (cfg->sram[pos] == key)
+      found = pos;
+  }
+
+  return found;
+}
+
+static inline bool ds3231_kv_is_live(DS3231_Cfg_t cfg, size_t pos, uint8_t skip_key)
+{
+  const uint8_t key = cfg->sram[pos];
+  return key != skip_key && cfg->sram[pos + 1] && ds3231_kv_find(cfg, key, pos) == (int)pos;
+}
+
+// Copy the live records other than skip_key and then the new record, if len is not 0, to the other bank and switch to
+// it. The bank in use is untouched until the new bank's header is written, last and in a transfer of its own, so a
+// failure before then leaves the old bank in use.
+static esp_err_t ds3231_kv_switch(DS3231_Cfg_t cfg, uint8_t skip_key, uint8_t key, const void* value, size_t len,
+                                  TickType_t timeout)
+{
+  const size_t base = cfg->kv_valid && cfg->kv_bank == 0 ? DS3231_KV_BANK_LEN : 0;
+  const size_t limit = base + DS3231_KV_BANK_LEN;
+  size_t out = base + DS3231_KV_HEADER_LEN;
+  for (size_t pos = cfg->kv_bank + DS3231_KV_HEADER_LEN; pos < cfg->sram_end;
+       pos += ds3231_kv_record_len(&cfg->sram[pos]))
+  {
+    if (ds3231_kv_is_live(cfg, pos, skip_key))
+    {
+      const size_t record_len = ds3231_kv_record_len(&cfg->sram[pos]);
+      if (out + record_len >= limit)
+        return ESP_ERR_NO_MEM;
+      out += record_len;
+    }
+  }
+  if (len && out + len + DS3231_KV_OVERHEAD >= limit)
+    return ESP_ERR_NO_MEM;
+
+  out = base + DS3231_KV_HEADER_LEN;
+  for (size_t pos = cfg->kv_bank + DS3231_KV_HEADER_LEN; pos < cfg->sram_end;
+       pos += ds3231_kv_record_len(&cfg->sram[pos]))
+  {
+    if (ds3231_kv_is_live(cfg, pos, skip_key))
+    {
+      const size_t record_len = ds3231_kv_record_len(&cfg->sram[pos]);
+      memcpy(&cfg->sram[out], &cfg->sram[pos], record_len);
+      out += record_len;
+    }
+  }
+
+  if (len)
+  {
+    uint8_t* record = &cfg->sram[out];
+    record[0] = key;
+    record[1] = len;
+    memcpy(&record[2], value, len);
+    record[len + 2] = ds3231_kv_record_crc(record);
+    out += len + DS3231_KV_OVERHEAD;
+  }
+  // filling the rest of the bank with end markers clears records left from its last use, which a later append
+  // interrupted before its end marker would otherwise expose
+  memset(&cfg->sram[out], DS3231_KV_END, limit - out);
+
+  const uint8_t gen = cfg->kv_gen + 1;
+  uint8_t* header = &cfg->sram[base];
+  header[0] = DS3231_KV_MAGIC;
+  header[1] = DS3231_KV_VERSION;
+  header[2] = gen;
+  header[3] = ds3231_kv_crc8(header, DS3231_KV_HEADER_LEN - 1);
+
+  const size_t start = base + DS3231_KV_HEADER_LEN;
+  esp_err_t res = ds3231_i2c_write(cfg, DS3232_SRAM_REG + start, &cfg->sram[start], limit - start, timeout);
+  if (res == ESP_OK)
+    res = ds3231_i2c_write(cfg, DS3232_SRAM_REG + base, header, DS3231_KV_HEADER_LEN, timeout);
+  if (res != ESP_OK)
+  {
+    // which bank is in use is no longer known
+    free(cfg->sram);
+    cfg->sram = NULL;
+    return res;
+  }
+
+  cfg->kv_bank = base;
+  cfg->kv_gen = gen;
+  cfg->kv_valid = true;
+  cfg->sram_end = out;
+  return ESP_OK;
+}
+
+static esp_err_t ds3231_kv_append(DS3231_Cfg_t cfg, uint8_t key, const void* value, size_t len, TickType_t timeout)
+{
+  const size_t record_len = len + DS3231_KV_OVERHEAD;
+  if (!cfg->kv_valid || cfg->sram_end + record_len >= cfg->kv_bank + DS3231_KV_BANK_LEN)
+    return ds3231_kv_switch(cfg, key, key, value, len, timeout);
+
+  // the record and the end marker go out in one burst
+  uint8_t* record = &cfg->sram[cfg->sram_end];
+  record[0] = key;
+  record[1] = len;
+  if (len)
+    memcpy(&record[2], value, len);
+  record[len + 2] = ds3231_kv_record_crc(record);
+  record[record_len] = DS3231_KV_END;
+
+  esp_err_t res = ds3231_i2c_write(cfg, DS3232_SRAM_REG + cfg->sram_end, record, record_len + 1, timeout);
+  if (res != ESP_OK)
+  {
+    // the SRAM may hold part of the burst, so the cache can no longer be trusted
+    free(cfg->sram);
+    cfg->sram = NULL;
+    return res;
+  }
+
+  cfg->sram_end += record_len;
+  return ESP_OK;
+}
+
+static esp_err_t ds3231_kv_mount_locked(DS3231_Cfg_t cfg, TickType_t timeout)
+{
+  if (!cfg->sram)
+  {
+    cfg->sram = malloc(DS3232_SRAM_LEN);
+    if (!cfg->sram)
+      return ESP_ERR_NO_MEM;
+  }
+
+  esp_err_t res = ds3231_i2c_read(cfg, DS3232_SRAM_REG, cfg->sram, DS3232_SRAM_LEN, timeout);
+  if (res != ESP_OK)
+  {
+    free(cfg->sram);
+    cfg->sram = NULL;
+    return res;
+  }
+
+  // with both headers valid, the newer generation is in use; the other bank may hold an interrupted compaction
+  const uint8_t* bank1 = &cfg->sram[DS3231_KV_BANK_LEN];
+  const bool valid0 = ds3231_kv_header_valid(cfg->sram);
+  const bool valid1 = ds3231_kv_header_valid(bank1);
+  cfg->kv_valid = valid0 || valid1;
+  cfg->kv_bank = valid1 && (!valid0 || (int8_t)(bank1[2] - cfg->sram[2]) > 0) ? DS3231_KV_BANK_LEN : 0;
+  cfg->kv_gen = cfg->kv_valid ? cfg->sram[cfg->kv_bank + 2] : 0;
+  cfg->sram_end = cfg->kv_valid ? ds3231_kv_scan(cfg->sram, cfg->kv_bank) : DS3231_KV_HEADER_LEN;
+  cfg->sram[cfg->sram_end] = DS3231_KV_END;
+  return ESP_OK;
+}
+
+esp_err_t ds3231_kv_mount(DS3231_Cfg_t cfg, TickType_t timeout)
+{
+  if (cfg->variant != DS3231_Variant_DS3232)
+    return ESP_ERR_NOT_SUPPORTED;
+  if (!ds3231_port_lock(&cfg->kv_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  esp_err_t res = ds3231_kv_mount_locked(cfg, timeout);
+  ds3231_port_unlock(&cfg->kv_lock);
+  return res;
+}
+
+esp_err_t ds3231_kv_format(DS3231_Cfg_t cfg, TickType_t timeout)
+{
+  if (!ds3231_port_lock(&cfg->kv_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  esp_err_t res = ESP_ERR_INVALID_STATE;
+  if (cfg->sram)
+  {
+    // no record is live, so the new bank only holds the end marker
+    cfg->sram_end = cfg->kv_bank + DS3231_KV_HEADER_LEN;
+    res = ds3231_kv_switch(cfg, DS3231_KV_END, DS3231_KV_END, NULL, 0, timeout);
+  }
+
+  ds3231_port_unlock(&cfg->kv_lock);
+  return res;
+}
+
+esp_err_t ds3231_kv_get(DS3231_Cfg_t cfg, uint8_t key, void* value, size_t* len)
+{
+  // an update holds the lock for at most one bus transfer, bounded by its own timeout
+  ds3231_port_lock(&cfg->kv_lock, portMAX_DELAY);
+
+  esp_err_t res = ESP_ERR_INVALID_STATE;
+  if (cfg->sram)
+  {
+    int pos = ds3231_kv_find(cfg, key, cfg->kv_bank + DS3231_KV_HEADER_LEN);
+    const size_t value_len = pos < 0 ? 0 : cfg->sram[pos + 1];
+    if (value_len == 0)
+    {
+      res = ESP_ERR_NOT_FOUND;
+    }
+    else if (*len < value_len)
+    {
+      *len = value_len;
+      res = ESP_ERR_INVALID_SIZE;
+    }
+    else
+    {
+      memcpy(value, &cfg->sram[pos + 2], value_len);
+      *len = value_len;
+      res = ESP_OK;
+    }
+  }
+
+  ds3231_port_unlock(&cfg->kv_lock);
+  return res;
+}
+
+esp_err_t ds3231_kv_set(DS3231_Cfg_t cfg, uint8_t key, const void* value, size_t len, TickType_t timeout)
+{
+  if (key == DS3231_KV_END || !value || len == 0 || len > DS3231_KV_MAX_VALUE)
+    return ESP_ERR_INVALID_ARG;
+  if (!ds3231_port_lock(&cfg->kv_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  esp_err_t res = ESP_ERR_INVALID_STATE;
+  if (cfg->sram)
+  {
+    int pos = ds3231_kv_find(cfg, key, cfg->kv_bank + DS3231_KV_HEADER_LEN);
+    if (pos >= 0 && cfg->sram[pos + 1] == len && !memcmp(&cfg->sram[pos + 2], value, len))
+      res = ESP_OK;
+    else
+      res = ds3231_kv_append(cfg, key, value, len, timeout);
+  }
+
+  ds3231_port_unlock(&cfg->kv_lock);
+  return res;
+}
+
+esp_err_t ds3231_kv_delete(DS3231_Cfg_t cfg, uint8_t key, TickType_t timeout)
+{
+  if (key == DS3231_KV_END)
+    return ESP_ERR_INVALID_ARG;
+  if (!ds3231_port_lock(&cfg->kv_lock, timeout))
+    return ESP_ERR_TIMEOUT;
+
+  esp_err_t res = ESP_ERR_INVALID_STATE;
+  if (cfg->sram)
+  {
+    int pos = ds3231_kv_find(cfg, key, cfg->kv_bank + DS3231_KV_HEADER_LEN);
+    if (pos < 0 || cfg->sram[pos + 1] == 0)
+      res = ESP_ERR_NOT_FOUND;
+    else
+      res = ds3231_kv_append(cfg, key, NULL, 0, timeout);
+  }
+
+  ds3231_port_unlock(&cfg->kv_lock);
+  return res;
+}
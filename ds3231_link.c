@@ -0,0 +1,200 @@
+#include "ds3231_priv.h"
+#include <ds3231_link.h>
+#include <string.h>
+
+#define DS3231_LINK_ALM_LEN (DS3231_ALM2_REG + DS3231_ALM2_LEN - DS3231_ALM1_REG)
+#define DS3231_LINK_CTRL_AIE 0x03 // A2IE | A1IE
+#define DS3231_LINK_CS_AF    0x03 // A2F | A1F
+
+typedef struct
+{
+  uint8_t alarms[DS3231_LINK_ALM_LEN];
+  uint8_t ctrl;
+  uint8_t cs;
+  uint8_t aging_offset;
+} DS3231_LinkSaved_t;
+
+static esp_err_t ds3231_link_save(DS3231_Cfg_t cfg, DS3231_LinkSaved_t* saved, TickType_t timeout)
+{
+  // alarms, control, status and aging offset are contiguous
+  uint8_t regs[DS3231_AGE_REG - DS3231_ALM1_REG + 1];
+  esp_err_t res = ds3231_i2c_read(cfg, DS3231_ALM1_REG, regs, sizeof(regs), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  memcpy(saved->alarms, regs, sizeof(saved->alarms));
+  saved->ctrl = regs[DS3231_CTRL_REG - DS3231_ALM1_REG];
+  saved->cs = regs[DS3231_CS_REG - DS3231_ALM1_REG];
+  saved->aging_offset = regs[DS3231_AGE_REG - DS3231_ALM1_REG];
+
+  // keep patterns that happen to match the time from asserting the interrupt pin
+  uint8_t ctrl = saved->ctrl & ~DS3231_LINK_CTRL_AIE;
+  return ds3231_i2c_write(cfg, DS3231_CTRL_REG, &ctrl, sizeof(ctrl), timeout);
+}
+
+static esp_err_t ds3231_link_restore(DS3231_Cfg_t cfg, const DS3231_LinkSaved_t* saved, TickType_t timeout)
+{
+  esp_err_t res = ds3231_i2c_write(cfg, DS3231_ALM1_REG, saved->alarms, sizeof(saved->alarms), timeout);
+  if (res == ESP_OK)
+    res = ds3231_i2c_write(cfg, DS3231_AGE_REG, &saved->aging_offset, sizeof(saved->aging_offset), timeout);
+
+  // alarm flags are cleared by writing 0 and unaffected by writing 1, so this only clears those raised by the test
+  uint8_t cs;
+  if (res == ESP_OK)
+    res = ds3231_i2c_read(cfg, DS3231_CS_REG, &cs, sizeof(cs), timeout);
+  if (res == ESP_OK && (cs & ~saved->cs & DS3231_LINK_CS_AF))
+  {
+    cs = (cs & ~DS3231_LINK_CS_AF) | (saved->cs & DS3231_LINK_CS_AF);
+    res = ds3231_i2c_write(cfg, DS3231_CS_REG, &cs, sizeof(cs), timeout);
+  }
+
+  if (res == ESP_OK)
+    res = ds3231_i2c_write(cfg, DS3231_CTRL_REG, &saved->ctrl, sizeof(saved->ctrl), timeout);
+  return res;
+}
+
+static inline uint32_t ds3231_xorshift(uint32_t* state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static void ds3231_link_record(DS3231_LinkResult_t* result, esp_err_t res, int64_t start, int64_t* total)
+{
+  int64_t elapsed = ds3231_port_time_us() - start;
+  result->transfers++;
+  if (res != ESP_OK)
+    result->errors++;
+  if (elapsed > result->latency_max_us)
+    result->latency_max_us = elapsed;
+  *total += elapsed;
+}
+
+static void ds3231_link_run(DS3231_Cfg_t cfg, uint32_t iterations, DS3231_LinkResult_t* result, TickType_t timeout)
+{
+  static const uint8_t fixed[] = { 0x00, 0xFF, 0x55, 0xAA };
+  uint32_t state = 0x2545F491;
+  int64_t total = 0;
+
+  for (uint32_t i = 0; i < iterations; i++)
+  {
+    uint8_t pattern[DS3231_LINK_ALM_LEN + 1];
+    if (i < sizeof(fixed))
+    {
+      memset(pattern, fixed[i], sizeof(pattern));
+    }
+    else
+    {
+      for (size_t j = 0; j < sizeof(pattern); j++)
+        pattern[j] = ds3231_xorshift(&state);
+    }
+
+    // a burst through all alarm registers and a single byte transfer of the aging offset
+    uint8_t readback[DS3231_LINK_ALM_LEN + 1];
+    int64_t start = ds3231_port_time_us();
+    esp_err_t res = ds3231_i2c_write(cfg, DS3231_ALM1_REG, pattern, DS3231_LINK_ALM_LEN, timeout);
+    ds3231_link_record(result, res, start, &total);
+
+    start = ds3231_port_time_us();
+    res = ds3231_i2c_read(cfg, DS3231_ALM1_REG, readback, DS3231_LINK_ALM_LEN, timeout);
+    ds3231_link_record(result, res, start, &total);
+    if (res == ESP_OK && memcmp(pattern, readback, DS3231_LINK_ALM_LEN))
+      result->mismatches++;
+
+    start = ds3231_port_time_us();
+    res = ds3231_i2c_write(cfg, DS3231_AGE_REG, &pattern[DS3231_LINK_ALM_LEN], 1, timeout);
+    ds3231_link_record(result, res, start, &total);
+
+    start = ds3231_port_time_us();
+    res = ds3231_i2c_read(cfg, DS3231_AGE_REG, &readback[DS3231_LINK_ALM_LEN], 1, timeout);
+    ds3231_link_record(result, res, start, &total);
+    if (res == ESP_OK && pattern[DS3231_LINK_ALM_LEN] != readback[DS3231_LINK_ALM_LEN])
+      result->mismatches++;
+  }
+
+  if (result->transfers)
+    result->latency_avg_us = total / result->transfers;
+}
+
+esp_err_t ds3231_link_characterize(DS3231_Cfg_t cfg, uint32_t iterations, DS3231_LinkResult_t* result,
+                                   TickType_t timeout)
+{
+  memset(result, 0, sizeof(*result));
+
+  DS3231_LinkSaved_t saved;
+  esp_err_t res = ds3231_link_save(cfg, &saved, timeout);
+  if (res != ESP_OK)
+    return res;
+
+  ds3231_link_run(cfg, iterations, result, timeout);
+  return ds3231_link_restore(cfg, &saved, timeout);
+}
+
+static esp_err_t ds3231_link_set_clk_speed(DS3231_Cfg_t cfg, const DS3231_LinkTuneCfg_t* tune, uint32_t clk_speed,
+                                           TickType_t timeout)
+{
+  if (tune->set_clk_speed)
+    return tune->set_clk_speed(tune->arg, clk_speed);
+  return ds3231_i2c_set_clk_speed(cfg, clk_speed, timeout);
+}
+
+esp_err_t ds3231_link_tune(DS3231_Cfg_t cfg, const DS3231_LinkTuneCfg_t* tune, DS3231_LinkResult_t* results,
+                           uint32_t* best_clk_speed, TickType_t timeout)
+{
+  if (!tune->clk_speed_count || !tune->iterations)
+    return ESP_ERR_INVALID_ARG;
+
+  // every entry is valid even if tuning stops early; those not reached have no transfers
+  uint32_t slowest = UINT32_MAX;
+  for (size_t i = 0; i < tune->clk_speed_count; i++)
+  {
+    memset(&results[i], 0, sizeof(results[i]));
+    results[i].clk_speed = tune->clk_speeds[i];
+    if (results[i].clk_speed < slowest)
+      slowest = results[i].clk_speed;
+  }
+
+  // registers are saved and restored at the speed in use before tuning, which is known to work
+  uint32_t initial = tune->initial_clk_speed;
+#if CONFIG_DS3231_I2C_BACKEND_MASTER
+  if (!initial && !tune->set_clk_speed)
+    initial = cfg->scl_speed_hz;
+#endif
+  if (!initial)
+    initial = slowest;
+
+  DS3231_LinkSaved_t saved;
+  esp_err_t res = ds3231_link_save(cfg, &saved, timeout);
+  if (res != ESP_OK)
+    return res;
+
+  uint32_t best = 0;
+  for (size_t i = 0; i < tune->clk_speed_count; i++)
+  {
+    DS3231_LinkResult_t* result = &results[i];
+    res = ds3231_link_set_clk_speed(cfg, tune, result->clk_speed, timeout);
+    if (res != ESP_OK)
+      break;
+
+    ds3231_link_run(cfg, tune->iterations, result, timeout);
+    if (!result->errors && !result->mismatches && result->clk_speed > best)
+      best = result->clk_speed;
+  }
+
+  esp_err_t restore_res = ds3231_link_set_clk_speed(cfg, tune, initial, timeout);
+  if (restore_res == ESP_OK)
+    restore_res = ds3231_link_restore(cfg, &saved, timeout);
+  if (res == ESP_OK)
+    res = restore_res;
+
+  const uint32_t selected = best ? best : slowest;
+  if (res == ESP_OK && selected != initial)
+    res = ds3231_link_set_clk_speed(cfg, tune, selected, timeout);
+  if (res != ESP_OK)
+    return res;
+
+  *best_clk_speed = selected;
+  return best ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,87 @@
+#include "ds3231_priv.h"
+
+#ifdef ESP_PLATFORM
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+int64_t ds3231_port_time_us(void)
+{
+  return esp_timer_get_time();
+}
+
+void ds3231_port_delay(TickType_t ticks)
+{
+  vTaskDelay(ticks);
+}
+
+void ds3231_port_lock_init(DS3231_PortLock_t* lock)
+{
+  lock->handle = xSemaphoreCreateMutexStatic(&lock->storage);
+}
+
+void ds3231_port_lock_deinit(DS3231_PortLock_t* lock)
+{
+  vSemaphoreDelete(lock->handle);
+}
+
+bool ds3231_port_lock(DS3231_PortLock_t* lock, TickType_t timeout)
+{
+  return xSemaphoreTake(lock->handle, timeout) == pdTRUE;
+}
+
+void ds3231_port_unlock(DS3231_PortLock_t* lock)
+{
+  xSemaphoreGive(lock->handle);
+}
+
+#else
+#include <time.h>
+
+int64_t ds3231_port_time_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void ds3231_port_delay(TickType_t ticks)
+{
+  struct timespec delay = { .tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000 };
+  while (nanosleep(&delay, &delay))
+    ;
+}
+
+void ds3231_port_lock_init(DS3231_PortLock_t* lock)
+{
+  pthread_mutex_init(lock, NULL);
+}
+
+void ds3231_port_lock_deinit(DS3231_PortLock_t* lock)
+{
+  pthread_mutex_destroy(lock);
+}
+
+bool ds3231_port_lock(DS3231_PortLock_t* lock, TickType_t timeout)
+{
+  if (timeout == portMAX_DELAY)
+    return pthread_mutex_lock(lock) == 0;
+
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  deadline.tv_sec += timeout / 1000;
+  deadline.tv_nsec += (long)(timeout % 1000) * 1000000;
+  if (deadline.tv_nsec >= 1000000000)
+  {
+    deadline.tv_sec++;
+    deadline.tv_nsec -= 1000000000;
+  }
+  return pthread_mutex_timedlock(lock, &deadline) == 0;
+}
+
+void ds3231_port_unlock(DS3231_PortLock_t* lock)
+{
+  pthread_mutex_unlock(lock);
+}
+
+#endif
@@ -0,0 +1,171 @@
+/*
+ * Internal definitions shared by the driver and its bus backends.
+ */
+#ifndef __DS3231_PRIV_H__
+#define __DS3231_PRIV_H__
+
+#include <ds3231.h>
+#if CONFIG_DS3231_TRACE
+#include <ds3231_trace.h>
+#endif
+#ifdef ESP_PLATFORM
+#include <freertos/semphr.h>
+#else
+#include <pthread.h>
+#endif
+
+#define DS3231_I2C_MAX_WRITE 256  // register address plus data
+#define DS3231_CTRL_CONV     0x20 // CONV bit in the control register
+
+#ifdef ESP_PLATFORM
+typedef struct
+{
+  StaticSemaphore_t storage;
+  SemaphoreHandle_t handle;
+} DS3231_PortLock_t;
+#else
+typedef pthread_mutex_t DS3231_PortLock_t;
+#endif
+
+#if CONFIG_DS3231_READ_CACHE
+// The last image of a group of registers which the chip updates on a fixed schedule.
+typedef struct
+{
+  uint8_t regs[DS3231_CAL_LEN];
+  bool valid;                         // regs holds the result of the last read
+  int64_t read_start_us;              // the read of regs started and ended between these times
+  int64_t read_end_us;
+  int64_t expires_us;                 // earliest time the chip may have updated the registers since
+  bool edge_known;                    // the registers were seen to change between edge_lo_us and edge_hi_us
+  int64_t edge_lo_us;
+  int64_t edge_hi_us;
+} DS3231_CacheLine_t;
+#endif
+
+struct DS3231_Cfg
+{
+  i2c_port_t i2c_port;
+  DS3231_Variant_t variant;           // set by ds3231_detect_variant
+  uint8_t* sram;                      // DS3232 SRAM cache, allocated by ds3231_kv_mount
+  size_t sram_end;                    // offset of the key-value store end marker in sram
+  size_t kv_bank;                     // offset in sram of the key-value bank in use
+  uint8_t kv_gen;                     // generation of that bank
+  bool kv_valid;                      // the bank has a valid header; otherwise the store is empty and unformatted
+  DS3231_PortLock_t kv_lock;          // serialises the key-value calls, which share sram and may free it
+#if CONFIG_DS3231_TRACE
+  DS3231_TraceWriter_t* trace;        // set by ds3231_trace_start
+  DS3231_PortLock_t trace_lock;       // serialises records, flushes and starting or stopping the trace
+#endif
+#if CONFIG_DS3231_READ_CACHE
+  DS3231_PortLock_t cache_lock;       // serialises cached reads and the writes which invalidate them
+  DS3231_CacheLine_t cache_cal;
+  DS3231_CacheLine_t cache_temp;
+#endif
+#if CONFIG_DS3231_I2C_BACKEND_MASTER
+  i2c_master_bus_handle_t bus;
+  i2c_master_dev_handle_t dev;
+  uint32_t scl_speed_hz;
+  DS3231_PortLock_t bus_lock;         // serialises queueing transfers and the synchronous transfer buffers
+  bool async;                         // callbacks registered, so every transfer on the device completes in the background
+  bool async_busy;                    // an asynchronous transfer is outstanding
+  DS3231_AsyncCb_t async_cb;
+  void* async_arg;
+  uint32_t queued;                    // transfers queued since callbacks were registered; they complete in order
+  volatile uint32_t completed;        // transfers completed, counted by the callback
+  uint32_t async_seq;                 // value of completed once the asynchronous transfer is done
+  uint32_t sync_seq;                  // value of completed once the last synchronous transfer is done
+  volatile esp_err_t sync_res;        // result of the last synchronous transfer
+  uint8_t sync_reg;
+  uint8_t sync_buf[DS3231_I2C_MAX_WRITE]; // queued transfers outlive the call if waiting for them times out
+  uint8_t async_buf[DS3231_I2C_MAX_WRITE];
+#endif
+#ifdef DS3231_I2C_SIM
+  uint8_t sim_regs[DS3232_REG_COUNT];
+  DS3231_Variant_t sim_variant;       // register behaviour modelled, set by ds3231_sim_set_variant
+  size_t sim_write_budget;            // register bytes written before writes fail, set by ds3231_sim_fail_writes_after
+#endif
+#ifndef ESP_PLATFORM
+  int fd;               // open /dev/i2c-N
+  bool smbus;           // adapter only supports SMBus I2C block transfers, e.g. i2c-stub
+#endif
+};
+
+// Number of addressable registers for the detected variant.
+static inline size_t ds3231_reg_count(DS3231_Cfg_t cfg)
+{
+  return cfg->variant == DS3231_Variant_DS3232 ? DS3232_REG_COUNT : DS3231_REG_COUNT;
+}
+
+// Implemented by the bus backend selected at build time.
+esp_err_t ds3231_i2c_open(DS3231_Cfg_t cfg);
+void ds3231_i2c_close(DS3231_Cfg_t cfg);
+esp_err_t ds3231_i2c_bus_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout);
+esp_err_t ds3231_i2c_bus_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout);
+esp_err_t ds3231_i2c_set_clk_speed(DS3231_Cfg_t cfg, uint32_t clk_speed, TickType_t timeout);
+
+#if CONFIG_DS3231_TRACE
+// Implemented in ds3231_trace.c; perform the transfer on the backend and record it.
+void ds3231_trace_init(DS3231_Cfg_t cfg);
+void ds3231_trace_deinit(DS3231_Cfg_t cfg);
+esp_err_t ds3231_trace_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout);
+esp_err_t ds3231_trace_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout);
+#endif
+
+// Every register access by the driver goes through these, so a trace sees the whole bus sequence.
+static inline esp_err_t ds3231_i2c_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len,
+                                        TickType_t timeout)
+{
+#if CONFIG_DS3231_TRACE
+  if (cfg->trace)
+    return ds3231_trace_read(cfg, reg, data, data_len, timeout);
+#endif
+  return ds3231_i2c_bus_read(cfg, reg, data, data_len, timeout);
+}
+
+static inline esp_err_t ds3231_i2c_transfer_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len,
+                                                  TickType_t timeout)
+{
+#if CONFIG_DS3231_TRACE
+  if (cfg->trace)
+    return ds3231_trace_write(cfg, reg, data, data_len, timeout);
+#endif
+  return ds3231_i2c_bus_write(cfg, reg, data, data_len, timeout);
+}
+
+#if CONFIG_DS3231_READ_CACHE
+// Implemented in ds3231_cache.c.
+void ds3231_cache_init(DS3231_Cfg_t cfg);
+void ds3231_cache_deinit(DS3231_Cfg_t cfg);
+esp_err_t ds3231_cache_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout);
+esp_err_t ds3231_cache_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout);
+// Drop the lines a write of data to reg may change. Called with cache_lock held.
+void ds3231_cache_invalidate(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len);
+#else
+// Reads of the calendar and temperature which may be served from the cache.
+static inline esp_err_t ds3231_cache_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len,
+                                          TickType_t timeout)
+{
+  return ds3231_i2c_read(cfg, reg, data, data_len, timeout);
+}
+#endif
+
+static inline esp_err_t ds3231_i2c_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len,
+                                         TickType_t timeout)
+{
+#if CONFIG_DS3231_READ_CACHE
+  // writes to the calendar or the control register, which may start a conversion, invalidate the cache
+  if (reg < DS3231_CAL_REG + DS3231_CAL_LEN || (reg <= DS3231_CTRL_REG && reg + data_len > DS3231_CTRL_REG))
+    return ds3231_cache_write(cfg, reg, data, data_len, timeout);
+#endif
+  return ds3231_i2c_transfer_write(cfg, reg, data, data_len, timeout);
+}
+
+// Implemented in ds3231_port.c for each platform.
+int64_t ds3231_port_time_us(void);
+void ds3231_port_delay(TickType_t ticks);
+void ds3231_port_lock_init(DS3231_PortLock_t* lock);
+void ds3231_port_lock_deinit(DS3231_PortLock_t* lock);
+bool ds3231_port_lock(DS3231_PortLock_t* lock, TickType_t timeout);
+void ds3231_port_unlock(DS3231_PortLock_t* lock);
+
+#endif // __DS3231_PRIV_H__
@@ -0,0 +1,40 @@
+#include <ds3231_time.h>
+#include <ds3231_regs.h>
+
+static inline int64_t ds3231_floor_div(int64_t a, int64_t b)
+{
+  return a / b - (a % b < 0);
+}
+
+int64_t ds3231_calendar_to_epoch(const DS3231_Calendar_t* calendar)
+{
+  int64_t days = ds3231_days_from_civil(calendar->year, calendar->month, calendar->day_of_month);
+  uint8_t hour = ds3231_hour24(calendar->clock_type, calendar->am_pm, calendar->hour);
+  return days * 86400 + hour * 3600 + calendar->minutes * 60 + calendar->seconds;
+}
+
+void ds3231_epoch_to_calendar(int64_t epoch, DS3231_Calendar_t* calendar)
+{
+  int64_t days = ds3231_floor_div(epoch, 86400);
+  int64_t secs = epoch - days * 86400;
+
+  // civil from days, the inverse of ds3231_days_from_civil
+  int64_t z = days + 719468;
+  int64_t era = ds3231_floor_div(z, 146097);
+  uint32_t doe = (uint32_t)(z - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  uint32_t month = mp < 10 ? mp + 3 : mp - 9;
+
+  calendar->year = (uint16_t)(yoe + era * 400 + (month <= 2));
+  calendar->month = month;
+  calendar->day_of_month = doy - (153 * mp + 2) / 5 + 1;
+  calendar->hour = secs / 3600;
+  calendar->minutes = secs / 60 % 60;
+  calendar->seconds = secs % 60;
+  calendar->clock_type = DS3231_ClockType_24_Hour;
+  calendar->am_pm = calendar->hour < 12 ? DS3231_AM : DS3231_PM;
+  // 1970-01-01 was a Thursday
+  calendar->day_of_week = (uint8_t)(days - ds3231_floor_div(days + 3, 7) * 7 + 3) + 1;
+}
@@ -0,0 +1,295 @@
+#include "ds3231_priv.h"
+#include <ds3231_timebase.h>
+#include <string.h>
+
+#ifdef ESP_PLATFORM
+#include <esp_attr.h>
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <hal/gpio_ll.h>
+#else
+#define IRAM_ATTR
+#endif
+
+#define DS3231_CTRL_RS_MASK  0x18
+#define DS3231_CTRL_RS_SHIFT 3
+#define DS3231_CTRL_INTCN    0x04
+
+static const uint32_t ds3231_sqw_freq_hz[] = { 1, 1024, 4096, 8192 };
+
+esp_err_t ds3231_timebase_init(DS3231_Timebase_t* tb, DS3231_Cfg_t cfg, DS3231_SquareWave_t square_wave_setting,
+                               TickType_t timeout)
+{
+  if (square_wave_setting > DS3231_SquareWave_8192Hz)
+    return ESP_ERR_INVALID_ARG;
+
+  // reset before the square wave starts, so no edge counted by an attached source is cleared
+  memset(tb, 0, sizeof(*tb));
+  tb->freq_hz = ds3231_sqw_freq_hz[square_wave_setting];
+
+  uint8_t ctrl;
+  esp_err_t res = ds3231_i2c_read(cfg, DS3231_CTRL_REG, &ctrl, sizeof(ctrl), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  // INT/SQW outputs the square wave only while INTCN is clear
+  ctrl = (ctrl & ~(DS3231_CTRL_RS_MASK | DS3231_CTRL_INTCN)) | (square_wave_setting << DS3231_CTRL_RS_SHIFT);
+  return ds3231_i2c_write(cfg, DS3231_CTRL_REG, &ctrl, sizeof(ctrl), timeout);
+}
+
+esp_err_t ds3231_timebase_resync(DS3231_Timebase_t* tb, DS3231_Cfg_t cfg, TickType_t timeout)
+{
+  uint8_t prev[DS3231_CAL_LEN];
+  uint8_t cal[DS3231_CAL_LEN];
+
+  // the calendar is latched when the read starts, so capture the edge count and local time just before each read
+  uint64_t edges_prev = ds3231_timebase_edges(tb);
+  int64_t local_prev = ds3231_port_time_us();
+  esp_err_t res = ds3231_i2c_read(cfg, DS3231_CAL_REG, prev, sizeof(prev), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  const int64_t deadline = local_prev + 1100000;
+  uint64_t edges;
+  int64_t local;
+  for (;;)
+  {
+    ds3231_port_delay(1);
+
+    edges = ds3231_timebase_edges(tb);
+    local = ds3231_port_time_us();
+    res = ds3231_i2c_read(cfg, DS3231_CAL_REG, cal, sizeof(cal), timeout);
+    if (res != ESP_OK)
+      return res;
+    if (cal[0] != prev[0])
+      break;
+    if (local > deadline)
+      return ESP_ERR_TIMEOUT;
+
+    edges_prev = edges;
+    local_prev = local;
+  }
+
+  // the second boundary lies between the last two reads
+  const uint64_t boundary_edges = edges_prev + (edges - edges_prev) / 2;
+  const int64_t boundary_local = local_prev + (local - local_prev) / 2;
+  const int64_t epoch = ds3231_raw_calendar_to_epoch(cal);
+  tb->edge_tolerance = (edges - edges_prev + 1) / 2 + 1;
+
+  if (tb->synced)
+  {
+    const int64_t expected = tb->sync_edges + (epoch - tb->sync_epoch) * tb->freq_hz;
+    tb->edge_error = (int32_t)((int64_t)boundary_edges - expected);
+
+    const int64_t elapsed_us = (epoch - tb->sync_epoch) * 1000000;
+    if (elapsed_us > 0)
+      tb->local_ppm = (int32_t)((boundary_local - tb->sync_local_us - elapsed_us) * 1000000 / elapsed_us);
+
+    // within the polling uncertainty the edge count is the better clock, so keep the timeline
+    if (tb->edge_error <= (int32_t)tb->edge_tolerance && tb->edge_error >= -(int32_t)tb->edge_tolerance)
+    {
+      tb->sync_edges = expected;
+      tb->sync_epoch = epoch;
+      tb->sync_local_us = boundary_local;
+      return ESP_OK;
+    }
+  }
+
+  tb->sync_edges = boundary_edges;
+  tb->sync_epoch = epoch;
+  tb->sync_local_us = boundary_local;
+  tb->synced = true;
+  return ESP_OK;
+}
+
+int64_t ds3231_timebase_now_us(const DS3231_Timebase_t* tb)
+{
+  const int64_t edges = (int64_t)(ds3231_timebase_edges(tb) - tb->sync_edges);
+  const int64_t seconds = edges / tb->freq_hz;
+  const int64_t fraction = edges % tb->freq_hz;
+  return (tb->sync_epoch + seconds) * 1000000 + fraction * 1000000 / tb->freq_hz;
+}
+
+uint32_t ds3231_timebase_elapsed_ticks(const DS3231_Timebase_t* tb, uint64_t* mark, uint32_t tick_hz)
+{
+  // the mark counts edges scaled by tick_hz, so one tick is exactly freq_hz units
+  const uint64_t ticks = (ds3231_timebase_edges(tb) * tick_hz - *mark) / tb->freq_hz;
+  *mark += ticks * tb->freq_hz;
+  return (uint32_t)ticks;
+}
+
+int64_t IRAM_ATTR ds3231_timebase_position_us(const DS3231_Timebase_t* tb, int64_t local_us)
+{
+  uint64_t edges = 0;
+  uint64_t stamp = 0;
+  // a stamp not matching the count is being written; retry a few times, then fall back to whole edges
+  for (int i = 0; i < 3; i++)
+  {
+    edges = ds3231_timebase_edges(tb);
+    stamp = __atomic_load_n(&tb->edge_stamp, __ATOMIC_ACQUIRE);
+    if ((uint32_t)(stamp >> 32) == (uint32_t)edges)
+      break;
+  }
+
+  const int64_t position = (int64_t)(edges * 1000000 / tb->freq_hz);
+  if (stamp == 0 || (uint32_t)(stamp >> 32) != (uint32_t)edges)
+    return position;
+
+  // the local clock only bridges the gap to the next edge, so it is bounded by one period
+  const int64_t period_us = 1000000 / tb->freq_hz;
+  int64_t since_us = (int32_t)((uint32_t)local_us - (uint32_t)stamp);
+  if (since_us < 0)
+    since_us = 0;
+  if (since_us > period_us)
+    since_us = period_us;
+  return position + since_us;
+}
+
+uint32_t IRAM_ATTR ds3231_timebase_slept_ticks(DS3231_Timebase_t* tb, int64_t start_us, int64_t end_us,
+                                               uint32_t tick_hz, uint32_t max_ticks)
+{
+  const int64_t slept = (end_us - start_us) * tick_hz + tb->sleep_carry;
+  if (slept <= 0)
+  {
+    tb->sleep_carry = 0;
+    return 0;
+  }
+
+  const uint64_t ticks = (uint64_t)slept / 1000000;
+  if (ticks >= max_ticks)
+  {
+    tb->sleep_carry = 0;
+    return max_ticks;
+  }
+  tb->sleep_carry = slept % 1000000;
+  return (uint32_t)ticks;
+}
+
+#ifdef ESP_PLATFORM
+// Handle a level change on INT/SQW: re-arm the interrupt, which is also the wakeup level, for the other level and
+// count the change to low as an edge. Called from the ISR and after light sleep, before the ISR has run.
+static void IRAM_ATTR ds3231_timebase_gpio_poll(DS3231_Timebase_t* tb)
+{
+  gpio_dev_t* hw = GPIO_LL_GET_HW(GPIO_PORT_0);
+  uint32_t level = __atomic_load_n(&tb->gpio_level, __ATOMIC_RELAXED);
+  if ((uint32_t)gpio_ll_get_level(hw, tb->gpio) != level)
+    return;
+
+  // the ISR may run on the other core; only one of them handles the change
+  if (!__atomic_compare_exchange_n(&tb->gpio_level, &level, !level, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return;
+  gpio_ll_set_intr_type(hw, tb->gpio, level ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+  if (level == 0)
+    ds3231_timebase_edge_at_from_isr(tb, esp_timer_get_time());
+}
+
+static void IRAM_ATTR ds3231_timebase_gpio_isr(void* arg)
+{
+  ds3231_timebase_gpio_poll(arg);
+}
+
+esp_err_t ds3231_timebase_attach_gpio(DS3231_Timebase_t* tb, gpio_num_t gpio)
+{
+  gpio_config_t conf = {
+    .pin_bit_mask = 1ULL << gpio,
+    .mode = GPIO_MODE_INPUT,
+    .pull_up_en = GPIO_PULLUP_ENABLE,
+    .pull_down_en = GPIO_PULLDOWN_DISABLE,
+    .intr_type = GPIO_INTR_DISABLE,
+  };
+  esp_err_t res = gpio_config(&conf);
+  if (res != ESP_OK)
+    return res;
+
+  // arm for the level the pin is not at; if it changes before arming, the interrupt fires at once for that change
+  tb->gpio = gpio;
+  tb->gpio_level = !gpio_get_level(gpio);
+  res = gpio_wakeup_enable(gpio, tb->gpio_level ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL);
+  if (res == ESP_OK)
+    res = esp_sleep_enable_gpio_wakeup();
+  if (res != ESP_OK)
+    return res;
+
+  // already installed by the application is fine
+  res = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  if (res != ESP_OK && res != ESP_ERR_INVALID_STATE)
+    return res;
+
+  res = gpio_isr_handler_add(gpio, ds3231_timebase_gpio_isr, tb);
+  if (res != ESP_OK)
+    return res;
+  return gpio_intr_enable(gpio);
+}
+
+esp_err_t ds3231_timebase_detach_gpio(gpio_num_t gpio)
+{
+  gpio_intr_disable(gpio);
+  gpio_wakeup_disable(gpio);
+  return gpio_isr_handler_remove(gpio);
+}
+
+#ifdef CONFIG_DS3231_TIMEBASE_TICKLESS
+// esp_pm's vApplicationSleep sleeps and then steps the tick by the RTC slow clock. It is linked with
+// --wrap=vApplicationSleep,--wrap=esp_light_sleep_start,--wrap=vTaskStepTick (see CMakeLists.txt), so the position is
+// taken around the sleep itself and the step is replaced by the edges counted. Each core sleeps on its own.
+typedef struct
+{
+  DS3231_Timebase_t* tb;
+  TickType_t idle_ticks;
+  bool started;
+  int64_t start_us;
+} DS3231_TimebaseSleep_t;
+
+static DS3231_Timebase_t* ds3231_timebase_tickless;
+static DS3231_TimebaseSleep_t ds3231_timebase_sleep[portNUM_PROCESSORS];
+
+void __real_vApplicationSleep(TickType_t expected_idle_ticks);
+esp_err_t __real_esp_light_sleep_start(void);
+void __real_vTaskStepTick(TickType_t ticks);
+
+void ds3231_timebase_set_tickless(DS3231_Timebase_t* tb)
+{
+  __atomic_store_n(&ds3231_timebase_tickless, tb, __ATOMIC_RELEASE);
+}
+
+void IRAM_ATTR __wrap_vApplicationSleep(TickType_t expected_idle_ticks)
+{
+  DS3231_TimebaseSleep_t* sleep = &ds3231_timebase_sleep[xPortGetCoreID()];
+  sleep->tb = __atomic_load_n(&ds3231_timebase_tickless, __ATOMIC_ACQUIRE);
+  sleep->idle_ticks = expected_idle_ticks;
+  sleep->started = false;
+  __real_vApplicationSleep(expected_idle_ticks);
+  sleep->tb = NULL;
+}
+
+esp_err_t IRAM_ATTR __wrap_esp_light_sleep_start(void)
+{
+  DS3231_TimebaseSleep_t* sleep = &ds3231_timebase_sleep[xPortGetCoreID()];
+  if (sleep->tb != NULL)
+  {
+    ds3231_timebase_gpio_poll(sleep->tb);
+    sleep->start_us = ds3231_timebase_position_us(sleep->tb, esp_timer_get_time());
+    sleep->started = true;
+  }
+  return __real_esp_light_sleep_start();
+}
+
+void IRAM_ATTR __wrap_vTaskStepTick(TickType_t ticks)
+{
+  DS3231_TimebaseSleep_t* sleep = &ds3231_timebase_sleep[xPortGetCoreID()];
+  if (sleep->tb != NULL && sleep->started)
+  {
+    // the edge that woke the chip has not been through the ISR yet
+    ds3231_timebase_gpio_poll(sleep->tb);
+    const int64_t end_us = ds3231_timebase_position_us(sleep->tb, esp_timer_get_time());
+    ticks = ds3231_timebase_slept_ticks(sleep->tb, sleep->start_us, end_us, configTICK_RATE_HZ, sleep->idle_ticks);
+    sleep->started = false;
+    if (ticks == 0)
+      return;
+  }
+  __real_vTaskStepTick(ticks);
+}
+#endif
+#endif
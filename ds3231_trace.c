@@ -0,0 +1,220 @@
+#include "ds3231_priv.h"
+#include <ds3231_trace.h>
+#include <string.h>
+
+#define DS3231_TRACE_VERSION 1
+
+static const uint8_t ds3231_trace_magic[4] = { 'D', '3', 'T', 'R' };
+
+static size_t ds3231_trace_varint_encode(uint64_t value, uint8_t* out)
+{
+  size_t len = 0;
+  while (value >= 0x80)
+  {
+    out[len++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[len++] = (uint8_t)value;
+  return len;
+}
+
+// Returns false if the varint is not terminated within the trace.
+static bool ds3231_trace_varint_decode(DS3231_TraceReader_t* reader, uint64_t* value)
+{
+  *value = 0;
+  for (unsigned shift = 0; shift < 64 && reader->pos < reader->size; shift += 7)
+  {
+    uint8_t byte = reader->data[reader->pos++];
+    *value |= (uint64_t)(byte & 0x7F) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+
+  return false;
+}
+
+esp_err_t ds3231_trace_writer_init(DS3231_TraceWriter_t* writer, uint8_t* buf, size_t size, DS3231_TraceFlush_t flush,
+                                   void* arg)
+{
+  if (size < DS3231_TRACE_HEADER_LEN || (flush && size < DS3231_TRACE_MAX_RECORD))
+    return ESP_ERR_INVALID_SIZE;
+
+  memset(writer, 0, sizeof(*writer));
+  writer->buf = buf;
+  writer->size = size;
+  writer->flush = flush;
+  writer->arg = arg;
+  writer->last_us = ds3231_port_time_us();
+
+  memcpy(buf, ds3231_trace_magic, sizeof(ds3231_trace_magic));
+  buf[sizeof(ds3231_trace_magic)] = DS3231_TRACE_VERSION;
+  writer->used = DS3231_TRACE_HEADER_LEN;
+  return ESP_OK;
+}
+
+void ds3231_trace_init(DS3231_Cfg_t cfg)
+{
+  ds3231_port_lock_init(&cfg->trace_lock);
+}
+
+void ds3231_trace_deinit(DS3231_Cfg_t cfg)
+{
+  ds3231_port_lock_deinit(&cfg->trace_lock);
+}
+
+static int ds3231_trace_flush(DS3231_TraceWriter_t* writer)
+{
+  if (!writer->flush || !writer->used)
+    return 0;
+
+  int res = writer->flush(writer->arg, writer->buf, writer->used);
+  if (res == 0)
+    writer->used = 0;
+  return res;
+}
+
+int ds3231_trace_sync(DS3231_TraceWriter_t* writer)
+{
+  // while recording, the writer is shared with every task using the DS3231
+  DS3231_Cfg_t cfg = writer->cfg;
+  if (!cfg)
+    return ds3231_trace_flush(writer);
+
+  ds3231_port_lock(&cfg->trace_lock, portMAX_DELAY);
+  int res = ds3231_trace_flush(writer);
+  ds3231_port_unlock(&cfg->trace_lock);
+  return res;
+}
+
+void ds3231_trace_start(DS3231_Cfg_t cfg, DS3231_TraceWriter_t* writer)
+{
+  ds3231_port_lock(&cfg->trace_lock, portMAX_DELAY);
+  writer->cfg = cfg;
+  cfg->trace = writer;
+  ds3231_port_unlock(&cfg->trace_lock);
+}
+
+void ds3231_trace_stop(DS3231_Cfg_t cfg)
+{
+  ds3231_port_lock(&cfg->trace_lock, portMAX_DELAY);
+  if (cfg->trace)
+    cfg->trace->cfg = NULL;
+  cfg->trace = NULL;
+  ds3231_port_unlock(&cfg->trace_lock);
+}
+
+// Called with trace_lock held.
+static void ds3231_trace_append(DS3231_TraceWriter_t* writer, bool write, uint8_t reg, const uint8_t* data,
+                                size_t data_len, int64_t start_us, uint32_t duration_us, esp_err_t res)
+{
+  const uint8_t* payload = write || res == ESP_OK ? data : NULL;
+
+  uint8_t head[DS3231_TRACE_MAX_RECORD - DS3231_I2C_MAX_WRITE];
+  size_t len = 0;
+  head[len++] = (write ? DS3231_TRACE_WRITE : 0) | (res != ESP_OK ? DS3231_TRACE_ERROR : 0);
+  head[len++] = reg;
+  len += ds3231_trace_varint_encode(data_len, head + len);
+  len += ds3231_trace_varint_encode(start_us > writer->last_us ? start_us - writer->last_us : 0, head + len);
+  len += ds3231_trace_varint_encode(duration_us, head + len);
+  if (res != ESP_OK)
+    len += ds3231_trace_varint_encode(((uint32_t)res << 1) ^ (uint32_t)(res >> 31), head + len);
+
+  size_t record_len = len + (payload ? data_len : 0);
+  // make room by flushing; without a flush callback, or if it fails, the record is dropped
+  if (writer->size - writer->used < record_len &&
+      (ds3231_trace_flush(writer) != 0 || writer->size - writer->used < record_len))
+  {
+    writer->dropped++;
+    return;
+  }
+
+  memcpy(writer->buf + writer->used, head, len);
+  if (payload)
+    memcpy(writer->buf + writer->used + len, payload, data_len);
+  writer->used += record_len;
+  writer->last_us = start_us;
+  writer->records++;
+}
+
+static void ds3231_trace_record(DS3231_Cfg_t cfg, bool write, uint8_t reg, const uint8_t* data, size_t data_len,
+                                int64_t start_us, esp_err_t res)
+{
+  uint32_t duration_us = (uint32_t)(ds3231_port_time_us() - start_us);
+
+  // the trace may have been stopped while the transfer was made
+  ds3231_port_lock(&cfg->trace_lock, portMAX_DELAY);
+  if (cfg->trace)
+    ds3231_trace_append(cfg->trace, write, reg, data, data_len, start_us, duration_us, res);
+  ds3231_port_unlock(&cfg->trace_lock);
+}
+
+esp_err_t ds3231_trace_read(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  int64_t start_us = ds3231_port_time_us();
+  esp_err_t res = ds3231_i2c_bus_read(cfg, reg, data, data_len, timeout);
+  ds3231_trace_record(cfg, false, reg, data, data_len, start_us, res);
+  return res;
+}
+
+esp_err_t ds3231_trace_write(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout)
+{
+  int64_t start_us = ds3231_port_time_us();
+  esp_err_t res = ds3231_i2c_bus_write(cfg, reg, data, data_len, timeout);
+  ds3231_trace_record(cfg, true, reg, data, data_len, start_us, res);
+  return res;
+}
+
+bool ds3231_trace_reader_init(DS3231_TraceReader_t* reader, const uint8_t* data, size_t size)
+{
+  memset(reader, 0, sizeof(*reader));
+  reader->data = data;
+  reader->size = size;
+  reader->pos = DS3231_TRACE_HEADER_LEN;
+
+  return size >= DS3231_TRACE_HEADER_LEN && memcmp(data, ds3231_trace_magic, sizeof(ds3231_trace_magic)) == 0 &&
+         data[sizeof(ds3231_trace_magic)] == DS3231_TRACE_VERSION;
+}
+
+bool ds3231_trace_next(DS3231_TraceReader_t* reader, DS3231_TraceRecord_t* record)
+{
+  if (reader->corrupt || reader->pos >= reader->size)
+    return false;
+
+  uint64_t len, dt_us, duration_us, err = 0;
+  if (reader->size - reader->pos < 2)
+  {
+    reader->corrupt = true;
+    return false;
+  }
+  uint8_t flags = reader->data[reader->pos++];
+  record->reg = reader->data[reader->pos++];
+
+  if ((flags & ~(DS3231_TRACE_WRITE | DS3231_TRACE_ERROR)) || !ds3231_trace_varint_decode(reader, &len) ||
+      len > DS3231_I2C_MAX_WRITE || !ds3231_trace_varint_decode(reader, &dt_us) ||
+      !ds3231_trace_varint_decode(reader, &duration_us) ||
+      ((flags & DS3231_TRACE_ERROR) && !ds3231_trace_varint_decode(reader, &err)))
+  {
+    reader->corrupt = true;
+    return false;
+  }
+
+  record->write = flags & DS3231_TRACE_WRITE;
+  record->len = len;
+  record->res = (flags & DS3231_TRACE_ERROR) ? (esp_err_t)((err >> 1) ^ -(err & 1)) : ESP_OK;
+  record->time_us = reader->time_us + (int64_t)dt_us;
+  record->duration_us = duration_us;
+  record->data = NULL;
+  if (record->write || record->res == ESP_OK)
+  {
+    if (reader->size - reader->pos < len)
+    {
+      reader->corrupt = true;
+      return false;
+    }
+    record->data = reader->data + reader->pos;
+    reader->pos += len;
+  }
+
+  reader->time_us = record->time_us;
+  return true;
+}
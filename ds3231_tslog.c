@@ -0,0 +1,180 @@
+#include <ds3231_tslog.h>
+#include <string.h>
+
+// Each entry is a varint of (zigzag(value) << 1) | absolute, where value is the epoch when absolute is set and the
+// difference from the previous timestamp otherwise. Both must be within +-2^62 to fit in 64 bits.
+#define DS3231_TSLOG_ABSOLUTE 1
+#define DS3231_TSLOG_ERASED   0xFF
+#define DS3231_TSLOG_LIMIT    ((int64_t)1 << 62)
+
+static inline uint64_t ds3231_zigzag_encode(int64_t value)
+{
+  return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+}
+
+static inline int64_t ds3231_zigzag_decode(uint64_t value)
+{
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static size_t ds3231_varint_encode(uint64_t value, uint8_t* out)
+{
+  size_t len = 0;
+  while (value >= 0x80)
+  {
+    out[len++] = (uint8_t)value | 0x80;
+    value >>= 7;
+  }
+  out[len++] = (uint8_t)value;
+  return len;
+}
+
+// Returns the number of bytes consumed, or 0 if the varint is not terminated within size bytes.
+static size_t ds3231_varint_decode(const uint8_t* in, size_t size, uint64_t* value)
+{
+  *value = 0;
+  for (size_t i = 0; i < size && i < DS3231_TSLOG_MAX_ENTRY; i++)
+  {
+    *value |= (uint64_t)(in[i] & 0x7F) << (7 * i);
+    if (!(in[i] & 0x80))
+      return i + 1;
+  }
+  return 0;
+}
+
+void ds3231_tslog_writer_init(DS3231_TsLogWriter_t* writer, uint8_t* block, size_t block_size,
+                              DS3231_TsLogFlush_t flush, void* arg)
+{
+  writer->block = block;
+  writer->block_size = block_size;
+  writer->used = 0;
+  writer->last = 0;
+  writer->flush = flush;
+  writer->arg = arg;
+  memset(block, DS3231_TSLOG_ERASED, block_size);
+}
+
+bool ds3231_tslog_writer_resume(DS3231_TsLogWriter_t* writer, uint8_t* block, size_t block_size,
+                                DS3231_TsLogFlush_t flush, void* arg)
+{
+  DS3231_TsLogReader_t reader;
+  size_t used = 0;
+  int64_t epoch, last = 0;
+  ds3231_tslog_reader_init(&reader, block, block_size, block_size);
+  while (ds3231_tslog_next(&reader, &epoch))
+  {
+    used = reader.pos;
+    last = epoch;
+  }
+
+  // entries after corruption could not be decoded, so a damaged block is not continued
+  if (reader.errors)
+  {
+    ds3231_tslog_writer_init(writer, block, block_size, flush, arg);
+    return false;
+  }
+
+  writer->block = block;
+  writer->block_size = block_size;
+  writer->used = used;
+  writer->last = last;
+  writer->flush = flush;
+  writer->arg = arg;
+  return true;
+}
+
+int ds3231_tslog_append(DS3231_TsLogWriter_t* writer, int64_t epoch)
+{
+  uint8_t entry[DS3231_TSLOG_MAX_ENTRY];
+  size_t len = 0;
+
+  if (epoch <= -DS3231_TSLOG_LIMIT || epoch >= DS3231_TSLOG_LIMIT)
+    return DS3231_TSLOG_ERR_RANGE;
+
+  // both timestamps are within +-2^62, so the difference cannot overflow, but it may need an absolute entry
+  const int64_t delta = epoch - writer->last;
+  const bool relative = delta > -DS3231_TSLOG_LIMIT && delta < DS3231_TSLOG_LIMIT;
+  if (writer->used)
+  {
+    len = relative ? ds3231_varint_encode(ds3231_zigzag_encode(delta) << 1, entry)
+                   : ds3231_varint_encode(ds3231_zigzag_encode(epoch) << 1 | DS3231_TSLOG_ABSOLUTE, entry);
+    if (writer->used + len > writer->block_size)
+    {
+      int res = writer->flush(writer->arg, writer->block, writer->block_size, true);
+      if (res)
+        return res;
+
+      memset(writer->block, DS3231_TSLOG_ERASED, writer->block_size);
+      writer->used = 0;
+    }
+  }
+
+  // every block starts with an absolute timestamp so it can be decoded on its own
+  if (!writer->used)
+    len = ds3231_varint_encode(ds3231_zigzag_encode(epoch) << 1 | DS3231_TSLOG_ABSOLUTE, entry);
+
+  memcpy(writer->block + writer->used, entry, len);
+  writer->used += len;
+  writer->last = epoch;
+  return 0;
+}
+
+int ds3231_tslog_append_raw(DS3231_TsLogWriter_t* writer, const uint8_t* cal)
+{
+  return ds3231_tslog_append(writer, ds3231_raw_calendar_to_epoch(cal));
+}
+
+int ds3231_tslog_sync(DS3231_TsLogWriter_t* writer)
+{
+  if (!writer->used)
+    return 0;
+
+  return writer->flush(writer->arg, writer->block, writer->block_size, false);
+}
+
+void ds3231_tslog_reader_init(DS3231_TsLogReader_t* reader, const uint8_t* data, size_t size, size_t block_size)
+{
+  reader->data = data;
+  reader->size = size;
+  reader->block_size = block_size;
+  reader->pos = 0;
+  reader->last = 0;
+  reader->errors = 0;
+}
+
+bool ds3231_tslog_next(DS3231_TsLogReader_t* reader, int64_t* epoch)
+{
+  while (reader->pos < reader->size)
+  {
+    size_t block_start = reader->pos - reader->pos % reader->block_size;
+    size_t block_end = block_start + reader->block_size;
+    if (block_end > reader->size)
+      block_end = reader->size;
+
+    uint64_t value;
+    size_t len = ds3231_varint_decode(reader->data + reader->pos, block_end - reader->pos, &value);
+    bool absolute = len && (value & DS3231_TSLOG_ABSOLUTE);
+    if (len && (absolute || reader->pos != block_start))
+    {
+      int64_t decoded = ds3231_zigzag_decode(value >> 1);
+      reader->last = absolute ? decoded : reader->last + decoded;
+      reader->pos += len;
+      *epoch = reader->last;
+      return true;
+    }
+
+    // an unterminated entry is either the erased tail of the block or corruption
+    for (size_t i = reader->pos; i < block_end; i++)
+    {
+      if (reader->data[i] != DS3231_TSLOG_ERASED)
+      {
+        reader->errors++;
+        break;
+      }
+    }
+
+    reader->pos = block_end;
+  }
+
+  return false;
+}
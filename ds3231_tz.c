@@ -0,0 +1,335 @@
+#include <ds3231_tz.h>
+#include <ds3231_regs.h>
+#include <ds3231_time.h>
+
+#define DS3231_TZ_DEFAULT_TIME  (2 * 3600)
+#define DS3231_TZ_MAX_TIME      (167 * 3600 + 59 * 60 + 59)
+
+static inline bool ds3231_is_leap(int32_t year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+static inline bool ds3231_is_alpha(char c)
+{
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static inline bool ds3231_is_digit(char c)
+{
+  return c >= '0' && c <= '9';
+}
+
+static bool ds3231_parse_number(const char** s, int32_t max, int32_t* value)
+{
+  if (!ds3231_is_digit(**s))
+    return false;
+
+  *value = 0;
+  while (ds3231_is_digit(**s))
+  {
+    *value = *value * 10 + (*(*s)++ - '0');
+    if (*value > max)
+      return false;
+  }
+  return true;
+}
+
+// Zone names are three or more letters, or any characters but '>' within angle brackets.
+static bool ds3231_parse_name(const char** s)
+{
+  const char* start = *s;
+  if (**s == '<')
+  {
+    while (**s && **s != '>')
+      (*s)++;
+    if (**s != '>')
+      return false;
+    (*s)++;
+    return *s - start >= 5;
+  }
+
+  while (ds3231_is_alpha(**s))
+    (*s)++;
+  return *s - start >= 3;
+}
+
+// [+|-]hh[:mm[:ss]] in seconds.
+static bool ds3231_parse_time(const char** s, int32_t max_hours, int32_t* seconds)
+{
+  int32_t sign = 1;
+  if (**s == '+' || **s == '-')
+    sign = *(*s)++ == '-' ? -1 : 1;
+
+  int32_t hours, minutes = 0, secs = 0;
+  if (!ds3231_parse_number(s, max_hours, &hours))
+    return false;
+  if (**s == ':')
+  {
+    (*s)++;
+    if (!ds3231_parse_number(s, 59, &minutes))
+      return false;
+    if (**s == ':')
+    {
+      (*s)++;
+      if (!ds3231_parse_number(s, 59, &secs))
+        return false;
+    }
+  }
+
+  *seconds = sign * (hours * 3600 + minutes * 60 + secs);
+  return true;
+}
+
+static bool ds3231_parse_rule(const char** s, DS3231_TzRule_t* rule)
+{
+  int32_t value;
+  if (**s == 'M')
+  {
+    int32_t month, week;
+    (*s)++;
+    if (!ds3231_parse_number(s, 12, &month) || month < 1 || *(*s)++ != '.')
+      return false;
+    if (!ds3231_parse_number(s, 5, &week) || week < 1 || *(*s)++ != '.')
+      return false;
+    if (!ds3231_parse_number(s, 6, &value))
+      return false;
+    rule->type = 'M';
+    rule->month = month;
+    rule->week = week;
+  }
+  else if (**s == 'J')
+  {
+    (*s)++;
+    if (!ds3231_parse_number(s, 365, &value) || value < 1)
+      return false;
+    rule->type = 'J';
+  }
+  else
+  {
+    if (!ds3231_parse_number(s, 365, &value))
+      return false;
+    rule->type = 'D';
+  }
+
+  rule->day = value;
+  rule->time = DS3231_TZ_DEFAULT_TIME;
+  if (**s == '/')
+  {
+    (*s)++;
+    return ds3231_parse_time(s, 167, &rule->time);
+  }
+  return true;
+}
+
+// Seconds since the epoch, in local time, at which the rule applies within year.
+static int64_t ds3231_rule_local(const DS3231_TzRule_t* rule, int32_t year)
+{
+  int64_t days;
+  if (rule->type == 'M')
+  {
+    int64_t first = ds3231_days_from_civil(year, rule->month, 1);
+    // 1970-01-01 was a Thursday, day 4 with Sunday as 0
+    int32_t first_wday = (int32_t)((first % 7 + 7 + 4) % 7);
+    int32_t mday = 1 + (rule->day - first_wday + 7) % 7 + 7 * (rule->week - 1);
+    static const uint8_t month_days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    int32_t days_in_month = month_days[rule->month - 1] + (rule->month == 2 && ds3231_is_leap(year));
+    while (mday > days_in_month)
+      mday -= 7;
+    days = first + mday - 1;
+  }
+  else
+  {
+    days = ds3231_days_from_civil(year, 1, 1) + rule->day;
+    // Julian days never count February 29
+    if (rule->type == 'J')
+      days += (ds3231_is_leap(year) && rule->day >= 60) - 1;
+  }
+
+  return days * 86400 + rule->time;
+}
+
+// The two transitions of a year in ascending order.
+static void ds3231_tz_year(const DS3231_Tz_t* tz, int32_t year, DS3231_TzTransition_t* out)
+{
+  DS3231_TzTransition_t start = { ds3231_rule_local(&tz->start, year) - tz->std_offset, tz->dst_offset };
+  DS3231_TzTransition_t end = { ds3231_rule_local(&tz->end, year) - tz->dst_offset, tz->std_offset };
+  if (start.at <= end.at)
+  {
+    out[0] = start;
+    out[1] = end;
+  }
+  else
+  {
+    out[0] = end;
+    out[1] = start;
+  }
+}
+
+bool ds3231_tz_compile(DS3231_Tz_t* tz, const char* posix_tz, uint16_t first_year, uint16_t last_year,
+                       DS3231_TzTransition_t* table, size_t capacity)
+{
+  const char* s = posix_tz;
+  int32_t offset;
+
+  // POSIX offsets are hours west of UTC
+  if (!ds3231_parse_name(&s) || !ds3231_parse_time(&s, 24, &offset))
+    return false;
+
+  tz->std_offset = -offset;
+  tz->dst_offset = tz->std_offset;
+  tz->has_dst = false;
+  tz->table = table;
+  tz->count = 0;
+  tz->cache_start = INT64_MAX;
+  tz->cache_end = INT64_MIN;
+  tz->cache_offset = tz->std_offset;
+  tz->cache_seq = 0;
+
+  if (*s)
+  {
+    if (!ds3231_parse_name(&s))
+      return false;
+
+    tz->has_dst = true;
+    tz->dst_offset = tz->std_offset + 3600;
+    if (*s && *s != ',')
+    {
+      if (!ds3231_parse_time(&s, 24, &offset))
+        return false;
+      tz->dst_offset = -offset;
+    }
+
+    if (*s)
+    {
+      if (*s++ != ',' || !ds3231_parse_rule(&s, &tz->start) || *s++ != ',' || !ds3231_parse_rule(&s, &tz->end))
+        return false;
+    }
+    else
+    {
+      // no rule given, use the POSIX default of the second Sunday of March to the first Sunday of November
+      tz->start = (DS3231_TzRule_t){ 'M', 0, 2, 3, DS3231_TZ_DEFAULT_TIME };
+      tz->end = (DS3231_TzRule_t){ 'M', 0, 1, 11, DS3231_TZ_DEFAULT_TIME };
+    }
+
+    if (*s)
+      return false;
+
+    for (int32_t year = first_year; year <= last_year && tz->count + 2 <= capacity; year++)
+    {
+      ds3231_tz_year(tz, year, &table[tz->count]);
+      tz->count += 2;
+    }
+  }
+
+  return true;
+}
+
+// The interval cache is a sequence lock, so tasks sharing a zone never see a torn interval: cache_seq is odd while it
+// is written, and a reader that sees it change searches instead. Only one writer updates it at a time;
+// a lookup that loses the race is not cached.
+static bool ds3231_tz_cache_get(const DS3231_Tz_t* tz, int64_t utc, int32_t* offset)
+{
+  const uint32_t seq = __atomic_load_n(&tz->cache_seq, __ATOMIC_ACQUIRE);
+  if (seq & 1)
+    return false;
+
+  const int64_t start = __atomic_load_n(&tz->cache_start, __ATOMIC_RELAXED);
+  const int64_t end = __atomic_load_n(&tz->cache_end, __ATOMIC_RELAXED);
+  const int32_t cached = __atomic_load_n(&tz->cache_offset, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_ACQUIRE);
+  if (__atomic_load_n(&tz->cache_seq, __ATOMIC_RELAXED) != seq || utc < start || utc >= end)
+    return false;
+
+  *offset = cached;
+  return true;
+}
+
+static void ds3231_tz_cache_set(DS3231_Tz_t* tz, int64_t start, int64_t end, int32_t offset)
+{
+  uint32_t seq = __atomic_load_n(&tz->cache_seq, __ATOMIC_RELAXED);
+  if ((seq & 1) ||
+      !__atomic_compare_exchange_n(&tz->cache_seq, &seq, seq + 1, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    return;
+
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+  __atomic_store_n(&tz->cache_start, start, __ATOMIC_RELAXED);
+  __atomic_store_n(&tz->cache_end, end, __ATOMIC_RELAXED);
+  __atomic_store_n(&tz->cache_offset, offset, __ATOMIC_RELAXED);
+  __atomic_store_n(&tz->cache_seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int32_t ds3231_tz_offset(DS3231_Tz_t* tz, int64_t utc)
+{
+  int32_t offset;
+  if (ds3231_tz_cache_get(tz, utc, &offset))
+    return offset;
+  if (!tz->has_dst)
+    return tz->std_offset;
+
+  DS3231_TzTransition_t years[6];
+  const DS3231_TzTransition_t* table = tz->table;
+  size_t count = tz->count;
+
+  if (!count || utc < table[0].at || utc >= table[count - 1].at)
+  {
+    // outside the precomputed years; daylight saving time never spans more than a year, so with the years either side
+    // of the one containing utc the interval is bounded on both sides and later lookups in it hit the cache
+    DS3231_Calendar_t calendar;
+    ds3231_epoch_to_calendar(utc + tz->std_offset, &calendar);
+    for (int32_t i = 0; i < 3; i++)
+      ds3231_tz_year(tz, calendar.year - 1 + i, &years[2 * i]);
+    table = years;
+    count = 6;
+  }
+
+  // find the last transition at or before utc; the offset before the first transition is that of the second
+  size_t lo = 0, hi = count;
+  while (lo < hi)
+  {
+    size_t mid = (lo + hi) / 2;
+    if (table[mid].at <= utc)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+
+  int64_t start, end;
+  if (lo == 0)
+  {
+    start = INT64_MIN;
+    end = table[0].at;
+    offset = table[1].offset;
+  }
+  else
+  {
+    start = table[lo - 1].at;
+    end = lo < count ? table[lo].at : INT64_MAX;
+    offset = table[lo - 1].offset;
+  }
+
+  // the years calculated only bound the interval on one side at either end
+  if (table == years)
+  {
+    if (lo == 0)
+      start = utc;
+    else if (lo == count)
+      end = utc + 1;
+  }
+
+  ds3231_tz_cache_set(tz, start, end, offset);
+  return offset;
+}
+
+int64_t ds3231_tz_to_utc(DS3231_Tz_t* tz, int64_t local)
+{
+  int64_t dst = local - tz->dst_offset;
+  if (tz->has_dst && ds3231_tz_offset(tz, dst) == tz->dst_offset)
+    return dst;
+  return local - tz->std_offset;
+}
+
+void ds3231_tz_local_calendar(DS3231_Tz_t* tz, const DS3231_Calendar_t* utc, DS3231_Calendar_t* local)
+{
+  ds3231_epoch_to_calendar(ds3231_tz_to_local(tz, ds3231_calendar_to_epoch(utc)), local);
+}
@@ -4,153 +4,61 @@
 #ifndef __DS3231_H__
 #define __DS3231_H__
 
+#ifdef ESP_PLATFORM
 #include <esp_types.h>
+#include <sdkconfig.h>
+#include <freertos/FreeRTOS.h>
+#if CONFIG_DS3231_I2C_BACKEND_MASTER
+#include <driver/i2c_master.h>
+#else
 #include <driver/i2c.h>
+#endif
+#else
+#include <ds3231_linux.h>
+#endif
+#include <ds3231_regs.h>
+#include <ds3231_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
 
 struct DS3231_Cfg; //!< Configuration structure for DS3231 component
 
 typedef struct DS3231_Cfg* DS3231_Cfg_t; //!< Configuration structure for DS3231 component
 
-/**
- * @enum DS3231_ClockType_t
- * @brief Defines use of 12 or 24 hour clock.
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_ClockType_24_Hour, //!< 24 Hour Clock
-  DS3231_ClockType_12_Hour  //!< 12 Hour Clock
-} DS3231_ClockType_t;
-
-/**
- * @enum DS3231_AM_PM_t
- * @brief AM and PM values for 12 Hour Clock
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_AM,    //!< AM
-  DS3231_PM     //!< PM
-} DS3231_AM_PM_t;
-
-/**
- * @brief Structure for DS3231 Calendar
- */
-typedef struct
-{
-  uint8_t seconds;                //!< Seconds in the minute 0-59
-  uint8_t minutes;                //!< Minutes in the hour 0-59
-  uint8_t hour;                   //!< The hour of the day, 0-23 for 24-hour clock, 1-12 for 12 hour clock
-  uint8_t day_of_week;            //!< User defined day of week, 1-7
-  uint8_t day_of_month;           //!< Day of the month, 1-31
-  uint8_t month;                  //!< Month of the year 1-12
-  uint16_t year;                  //!< The year, 2000-2199
-  DS3231_ClockType_t clock_type;  //!< The type of the clock, either 12 or 24-hour clock. Defines how hour is interpreted
-  DS3231_AM_PM_t am_pm;           //!< Either AM or PM. Only used when clock type is 12-hour clock
-} DS3231_Calendar_t;
-
-/**
- * @enum DS3231_AlarmDayType_t
- * @brief Defines how to interpret DS3231_AlarmSetting_t.day
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_AlarmDayType_DayOfMonth, //!< Day is day of month 1-31
-  DS3231_AlarmDayType_DayOfWeek   //!< Day is day of week 1-7
-} DS3231_AlarmDayType_t;
-
-/**
- * @enum DS3231_AlarmRate_t
- * @brief The rate at which the alarm will be fired. 
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_AlarmRate_PerSecond  = 0x0F, //!< Once per second (Alarm 1)
-  DS3231_AlarmRate_S_Match    = 0x0E, //!< Seconds Match (Alarm 1)
-  DS3231_AlarmRate_MS_Match   = 0x0C, //!< Minutes and Seconds Match (Alarm 1)
-  DS3231_AlarmRate_HMS_Match  = 0x08, //!< Hours, Minutes, and Seconds Match (Alarm 1)
-  DS3231_AlarmRate_DHMS_Match = 0x00, //!< Day, Hours, Minutes, and Seconds Match (Alarm 1)
-
-  DS3231_AlarmRate_PerMinute  = 0x07, //!< Once per minute (Alarm 2)
-  DS3231_AlarmRate_M_Match    = 0x06, //!< Minutes Match (Alarm 2)
-  DS3231_AlarmRate_HM_Match   = 0x04, //!< Hours and Minutes Match (Alarm 2)
-  DS3231_AlarmRate_DHM_Match  = 0x00, //!< Day, Hours, and Minutes Match (Alarm 2)
-} DS3231_AlarmRate_t;
-
-/**
- * @brief The selection of alarm in DS3231_AlarmSetting_t
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_AlarmType_Alarm1 = 1, //!< Use Alarm 1
-  DS3231_AlarmType_Alarm2 = 2  //!< Use Alarm 2
-} DS3231_AlarmType_t;
-
-/**
- * @brief Alarm configuration.
- */
-typedef struct
-{
-  uint8_t seconds;                  //!< The seconds on which the alarm should match. Alarm 1 only.
-  uint8_t minutes;                  //!< The minutes on which the alarm should match.
-  uint8_t hour;                     //!< The hour on which the alarm should match.
-  uint8_t day;                      //!< The day on which the alarm should match; day_type defines whether this is day of week or day of month.
-
-  DS3231_AlarmType_t alarm_type;    //!< Selection of alarm 1 or alarm 2.
-  DS3231_ClockType_t clock_type;    //!< Whether alarm hour should be interpreted on a 12 or 24-hour clock
-  DS3231_AM_PM_t am_pm;             //!< If clock_type == DS3231_ClockType_12_Hour then this defines whether the hour is AM or PM.
-  DS3231_AlarmDayType_t day_type;   //!< Flag for whether day is day of week or day of month
-  DS3231_AlarmRate_t alarm_rate;    //!< The alarm rate on which the alarm will fire.
-} DS3231_AlarmSetting_t;
+struct DS3231_Tz; //!< Compiled time zone, see ds3231_tz.h
 
 /**
- * @brief Flags for interrupt enable or interrupt fired.
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_Interrupt_None     = 0x00, //!< No interrupts enabled or no interrupt fired.
-  DS3231_Interrupt_Alarm_1  = 0x01, //!< Alarm 1 interrupt enable or Alarm 1 interrupt fired.
-  DS3231_Interrupt_Alarm_2  = 0x02  //!< Alarm 1 interrupt enable or Alarm 2 interrupt fired.
-} DS3231_Interrupt_t;
-
-/**
- * @brief Square wave frequencies
- */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_SquareWave_1Hz     = 0x00, //!< Output 1Hz square wave
-  DS3231_SquareWave_1024Hz  = 0x01, //!< Output 1024Hz square wave
-  DS3231_SquareWave_4096Hz  = 0x02, //!< Output 4096Hz square wave
-  DS3231_SquareWave_8192Hz  = 0x03, //!< Output 8192Hz square wave
-  DS3231_SquareWave_Off     = 0xFF  //!< Disable square wave generation
-} DS3231_SquareWave_t;
-
-/**
- * @brief Flag for enabling the oscillator.
+ * @brief Construct configuration for DS3231. This does not initialize the i2c system. Use ds3231_delete to free the returned pointer.
+ * 
+ * @param i2c_port The i2c port to use, either I2C_NUM_0 or I2C_NUM_1. On Linux, the adapter number N of /dev/i2c-N.
+ * @return An initialised DS3231_Cfg_t or NULL if unable to allocate resource or DS3231 is not found.
  */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_Oscillator_Enable  = 0,  //!< Oscillator is enabled
-  DS3231_Oscillator_Disable = 1   //!< Oscillator is disabled
-} DS3231_Oscillator_t;
+DS3231_Cfg_t ds3231_create(i2c_port_t i2c_port);
 
+#if CONFIG_DS3231_I2C_BACKEND_MASTER
 /**
- * @brief Flag for enabling the 32kHz signal generation
+ * @brief Completion callback for asynchronous transfers. Called from the i2c interrupt handler.
+ *
+ * @param arg The user argument passed with the transfer.
+ * @param res ESP_OK if the transfer completed, ESP_FAIL if the DS3231 did not acknowledge.
  */
-typedef enum __attribute__((__packed__))
-{
-  DS3231_32kHz_Disable  = 0,  //!< 32kHz signal generation is disabled
-  DS3231_32kHz_Enable   = 1   //!< 32kHz signal generation is enabled
-} DS3231_32kHz_t;
+typedef void (*DS3231_AsyncCb_t)(void* arg, esp_err_t res);
 
 /**
- * @brief Construct configuration for DS3231. This does not initialize the i2c system. Use ds3231_delete to free the returned pointer.
+ * @brief Construct configuration for a DS3231 on a bus created with i2c_new_master_bus. ds3231_create does the same for
+ * the bus already created on an i2c port. Use ds3231_delete to free the returned pointer; the bus is not deleted.
  * 
- * @param i2c_port The i2c port to use, either I2C_NUM_0 or I2C_NUM_1
+ * @param bus The i2c master bus the DS3231 is connected to.
  * @return An initialised DS3231_Cfg_t or NULL if unable to allocate resource or DS3231 is not found.
  */
-DS3231_Cfg_t ds3231_create(i2c_port_t i2c_port);
+DS3231_Cfg_t ds3231_create_from_bus(i2c_master_bus_handle_t bus);
+#endif
 
 /**
- * @brief Return the current calendar from the DS3231.
+ * @brief Return the current calendar from the DS3231. All calendar registers are read in a single transaction, which
+ * the DS3231 latches at the start, so the result cannot be torn by a rollover and does not need to be read twice.
  * 
  * @param cfg The configuration for the DS3231 component.
  * @param[out] calendar The calendar to populate.
@@ -159,6 +67,18 @@ DS3231_Cfg_t ds3231_create(i2c_port_t i2c_port);
  */
 esp_err_t ds3231_get_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, TickType_t timeout);
 
+/**
+ * @brief Return the current calendar from the DS3231, which is assumed to be kept in UTC, converted to local time.
+ * 
+ * @param cfg The configuration for the DS3231 component.
+ * @param tz The time zone compiled with ds3231_tz_compile.
+ * @param[out] calendar The local calendar to populate, using the 24-hour clock and the ISO 8601 day of week.
+ * @param timeout The number of ticks to wait for the DS3231 to respond.
+ * @return esp_err_t ESP_OK if calendar was populated, ESP_ERR_* otherwise.
+ */
+esp_err_t ds3231_get_local_calendar(DS3231_Cfg_t cfg, struct DS3231_Tz* tz, DS3231_Calendar_t* calendar,
+                                    TickType_t timeout);
+
 /**
  * @brief Set the calendar in the DS3231. 
  * 
@@ -169,6 +89,30 @@ esp_err_t ds3231_get_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, Tic
  */
 esp_err_t ds3231_set_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, TickType_t timeout);
 
+#if CONFIG_DS3231_TEMPERATURE
+/**
+ * @brief Get the temperature from the DS3231 in quarter degrees Celsius, without using floating point.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param[out] temperature_q2 The temperature as reported by the DS3231, in units of 0.25°C.
+ * @param timeout The number of ticks to wait for the DS3231 to respond.
+ * @return esp_err_t 
+ */
+esp_err_t ds3231_get_temperature_q2(DS3231_Cfg_t cfg, int16_t* temperature_q2, TickType_t timeout);
+
+/**
+ * @brief As ds3231_get_calendar_temperature, with the temperature in quarter degrees Celsius.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param[out] calendar The calendar to populate, or NULL.
+ * @param[out] temperature_q2 The temperature as reported by the DS3231, in units of 0.25°C, or NULL.
+ * @param timeout The number of ticks to wait for the DS3231 to respond, and for the temperature to settle.
+ * @return esp_err_t ESP_ERR_TIMEOUT if the temperature registers kept changing for longer than timeout.
+ */
+esp_err_t ds3231_get_calendar_temperature_q2(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, int16_t* temperature_q2,
+                                             TickType_t timeout);
+
+#if CONFIG_DS3231_TEMPERATURE_FLOAT
 /**
  * @brief Get the temperature from the DS3231.
  * 
@@ -179,6 +123,23 @@ esp_err_t ds3231_set_calendar(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, Tic
  */
 esp_err_t ds3231_get_temperature(DS3231_Cfg_t cfg, float* temperature, TickType_t timeout);
 
+/**
+ * @brief Get the calendar and temperature as one consistent snapshot. Calendar, status and temperature registers are
+ * read in a single transaction. When a temperature conversion was in progress and could have updated the temperature
+ * registers during it, 4 bytes are re-read until the conversion has finished or two reads agree, usually once.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param[out] calendar The calendar to populate, or NULL.
+ * @param[out] temperature The temperature as reported by the DS3231, or NULL.
+ * @param timeout The number of ticks to wait for the DS3231 to respond, and for the temperature to settle.
+ * @return esp_err_t ESP_ERR_TIMEOUT if the temperature registers kept changing for longer than timeout.
+ */
+esp_err_t ds3231_get_calendar_temperature(DS3231_Cfg_t cfg, DS3231_Calendar_t* calendar, float* temperature,
+                                          TickType_t timeout);
+#endif
+#endif
+
+#if CONFIG_DS3231_ALARMS
 /**
  * @brief Get an alarm configuration. The parameter alarm must have alarm_type set in order to get an alarm.
  * 
@@ -198,6 +159,7 @@ esp_err_t ds3231_get_alarm(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickT
  * @return esp_err_t 
  */
 esp_err_t ds3231_set_alarm(DS3231_Cfg_t cfg, DS3231_AlarmSetting_t* alarm, TickType_t timeout);
+#endif
 
 /**
  * @brief Set the frequency of the square wave generated. Changing this setting from 1Hz is not supported on DS3231M chips.
@@ -219,6 +181,7 @@ esp_err_t ds3231_set_square_wave(DS3231_Cfg_t cfg, DS3231_SquareWave_t square_wa
  */
 esp_err_t ds3231_get_square_wave(DS3231_Cfg_t cfg, DS3231_SquareWave_t* square_wave_setting, TickType_t timeout);
 
+#if CONFIG_DS3231_TEMPERATURE
 /**
  * @brief Assert the convert bit and trigger a temperature conversion.
  * 
@@ -237,6 +200,7 @@ esp_err_t ds3231_set_convert_temperature(DS3231_Cfg_t cfg, TickType_t timeout);
  * @return esp_err_t 
  */
 esp_err_t ds3231_get_convert_temperature(DS3231_Cfg_t cfg, uint8_t* conv, TickType_t timeout);
+#endif
 
 /**
  * @brief Enable or disable the oscillator in the DS3231 chip.
@@ -307,6 +271,7 @@ esp_err_t ds3231_get_osc_stop_flag(DS3231_Cfg_t cfg, uint8_t* osc_stop_flag, Tic
  */
 esp_err_t ds3231_clear_osc_stop_flag(DS3231_Cfg_t cfg, TickType_t timeout);
 
+#if CONFIG_DS3231_ALARMS
 /**
  * @brief Clear the alarm interrupt fired flag.
  * 
@@ -347,6 +312,7 @@ esp_err_t ds3231_set_intr_en(DS3231_Cfg_t cfg, DS3231_Interrupt_t intr_flag, Tic
  * @return esp_err_t 
  */
 esp_err_t ds3231_get_intr_en(DS3231_Cfg_t cfg, DS3231_Interrupt_t* intr_flag, TickType_t timeout);
+#endif
 
 /**
  * @brief Write an aging offset to the DS3231.
@@ -368,6 +334,96 @@ esp_err_t ds3231_get_aging_offset(DS3231_Cfg_t cfg, uint8_t* aging_offset, TickT
  */
 esp_err_t ds3231_set_aging_offset(DS3231_Cfg_t cfg, uint8_t aging_offset, TickType_t timeout);
 
+/**
+ * @brief Detect whether the chip is a DS3231, DS3231M or DS3232. The DS3232 is recognised by its conversion rate bits
+ * and the DS3231M by its lack of RS bits. The RS bits are only probed while INT/SQW is in interrupt mode, so a DS3231M
+ * outputting its square wave is reported as a DS3231. The result is kept in cfg and extends the range accepted by
+ * ds3231_read_raw and ds3231_write_raw to the DS3232 SRAM.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param[out] variant Optional; the detected variant.
+ * @param timeout The number of ticks to wait for the DS3231 to respond to each transfer.
+ * @return esp_err_t 
+ */
+esp_err_t ds3231_detect_variant(DS3231_Cfg_t cfg, DS3231_Variant_t* variant, TickType_t timeout);
+
+/**
+ * @brief Bring the alarm, control, status and aging offset registers into the state described by config. The registers
+ * are read in one transaction and only the contiguous runs of registers that differ are written, so applying a
+ * configuration which is already in place costs a single read. Alarm and oscillator stop flags are never cleared.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param config The desired state.
+ * @param[out] changed_regs Optional; bit n is set if register n was written.
+ * @param timeout The number of ticks to wait for the DS3231 to respond to each transfer.
+ * @return esp_err_t ESP_ERR_INVALID_ARG if an alarm setting is invalid, in which case nothing is written.
+ * ESP_ERR_NOT_SUPPORTED if alarms or interrupts are requested with CONFIG_DS3231_ALARMS disabled.
+ */
+esp_err_t ds3231_apply_config(DS3231_Cfg_t cfg, const DS3231_Config_t* config, uint32_t* changed_regs,
+                              TickType_t timeout);
+
+/**
+ * @brief Read a range of registers into a caller-owned buffer without decoding. The DS3231 latches the time registers
+ * at the start of the transaction so a single read of the calendar range is always consistent. Use the ds3231_raw_*
+ * helpers in ds3231_regs.h to decode fields in place.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param reg The first register to read.
+ * @param[out] data The buffer to store the register image.
+ * @param data_len The number of registers to read.
+ * @param timeout The number of ticks to wait for the DS3231 to respond.
+ * @return esp_err_t ESP_ERR_INVALID_SIZE if the range extends past the register map.
+ */
+esp_err_t ds3231_read_raw(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, TickType_t timeout);
+
+/**
+ * @brief Write a range of registers from a caller-owned buffer without encoding.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param reg The first register to write.
+ * @param[in] data The register image to write.
+ * @param data_len The number of registers to write.
+ * @param timeout The number of ticks to wait for the DS3231 to respond.
+ * @return esp_err_t ESP_ERR_INVALID_SIZE if the range extends past the register map.
+ */
+esp_err_t ds3231_write_raw(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len, TickType_t timeout);
+
+#if CONFIG_DS3231_I2C_BACKEND_MASTER
+/**
+ * @brief Start reading a range of registers without waiting for the transfer to finish. Requires the bus to have been
+ * created with a non-zero trans_queue_depth. Once an asynchronous transfer has been made, the synchronous functions wait
+ * for every queued transfer on the bus before returning; if that wait times out they return ESP_ERR_TIMEOUT and their
+ * transfer completes later from a buffer owned by cfg. Only one asynchronous transfer may be outstanding per DS3231.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param reg The first register to read.
+ * @param[out] data Buffer for data_len bytes, which must remain valid until cb is called.
+ * @param data_len The number of registers to read.
+ * @param cb Called from the i2c interrupt handler when the transfer completes.
+ * @param arg User argument for cb.
+ * @return esp_err_t ESP_ERR_INVALID_STATE if a transfer is already outstanding, ESP_ERR_NOT_SUPPORTED if the bus has
+ * no transaction queue, ESP_ERR_TIMEOUT without waiting if another task is in a transfer with this DS3231.
+ */
+esp_err_t ds3231_read_raw_async(DS3231_Cfg_t cfg, uint8_t reg, uint8_t* data, size_t data_len, DS3231_AsyncCb_t cb,
+                                void* arg);
+
+/**
+ * @brief Start writing a range of registers without waiting for the transfer to finish. data is copied, so it need not
+ * remain valid. Otherwise as ds3231_read_raw_async.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param reg The first register to write.
+ * @param data The data to write.
+ * @param data_len The number of registers to write.
+ * @param cb Called from the i2c interrupt handler when the transfer completes.
+ * @param arg User argument for cb.
+ * @return esp_err_t ESP_ERR_INVALID_STATE if a transfer is already outstanding, ESP_ERR_NOT_SUPPORTED if the bus has
+ * no transaction queue.
+ */
+esp_err_t ds3231_write_raw_async(DS3231_Cfg_t cfg, uint8_t reg, const uint8_t* data, size_t data_len,
+                                 DS3231_AsyncCb_t cb, void* arg);
+#endif
+
 /**
  * @brief Free the resources used by the cfg parameter.
  * 
@@ -375,4 +431,8 @@ esp_err_t ds3231_set_aging_offset(DS3231_Cfg_t cfg, uint8_t aging_offset, TickTy
  */
 void ds3231_delete(DS3231_Cfg_t cfg);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // __DS3231_H__
@@ -0,0 +1,318 @@
+/*!
+ * @file
+ * @brief Optional C++17 front-end for the esp32-ds3231 component.
+ *
+ * Register layouts are described with constexpr descriptors so that field accesses compile down to a single mask and
+ * shift, and calendar/alarm literals are validated with static_assert rather than at run time.
+ */
+#ifndef __DS3231_HPP__
+#define __DS3231_HPP__
+
+#include <cstdint>
+#include <type_traits>
+#include <ds3231.h>
+
+namespace ds3231
+{
+
+/**
+ * @brief Describes a contiguous bit field within a DS3231 register.
+ *
+ * @tparam Reg The register descriptor which owns the field.
+ * @tparam Shift The position of the least significant bit of the field.
+ * @tparam Width The number of bits in the field.
+ */
+template <typename Reg, uint8_t Shift, uint8_t Width>
+struct bits
+{
+  static_assert(Width > 0 && Shift + Width <= 8, "field must fit in an 8-bit register");
+
+  using reg_type = Reg;                     //!< The register owning this field
+  static constexpr uint8_t shift = Shift;   //!< Position of the least significant bit
+  static constexpr uint8_t width = Width;   //!< Number of bits in the field
+  static constexpr uint8_t mask = static_cast<uint8_t>(((1u << Width) - 1u) << Shift); //!< Mask of the field in the register
+};
+
+struct Seconds      { static constexpr uint8_t address = DS3231_CAL_REG; };       //!< Seconds register
+struct Minutes      { static constexpr uint8_t address = DS3231_CAL_REG + 1; };   //!< Minutes register
+struct Hours        { static constexpr uint8_t address = DS3231_CAL_REG + 2; };   //!< Hours register
+struct Day          { static constexpr uint8_t address = DS3231_CAL_REG + 3; };   //!< Day of week register
+struct Date         { static constexpr uint8_t address = DS3231_CAL_REG + 4; };   //!< Day of month register
+struct Month        { static constexpr uint8_t address = DS3231_CAL_REG + 5; };   //!< Month/century register
+struct Year         { static constexpr uint8_t address = DS3231_CAL_REG + 6; };   //!< Year register
+struct A1Seconds    { static constexpr uint8_t address = DS3231_ALM1_REG; };      //!< Alarm 1 seconds register
+struct A1Minutes    { static constexpr uint8_t address = DS3231_ALM1_REG + 1; };  //!< Alarm 1 minutes register
+struct A1Hours      { static constexpr uint8_t address = DS3231_ALM1_REG + 2; };  //!< Alarm 1 hours register
+struct A1Day        { static constexpr uint8_t address = DS3231_ALM1_REG + 3; };  //!< Alarm 1 day/date register
+struct A2Minutes    { static constexpr uint8_t address = DS3231_ALM2_REG; };      //!< Alarm 2 minutes register
+struct A2Hours      { static constexpr uint8_t address = DS3231_ALM2_REG + 1; };  //!< Alarm 2 hours register
+struct A2Day        { static constexpr uint8_t address = DS3231_ALM2_REG + 2; };  //!< Alarm 2 day/date register
+struct Control      { static constexpr uint8_t address = DS3231_CTRL_REG; };      //!< Control register
+struct Status       { static constexpr uint8_t address = DS3231_CS_REG; };        //!< Control/status register
+struct AgingOffset  { static constexpr uint8_t address = DS3231_AGE_REG; };       //!< Aging offset register
+struct TempMSB      { static constexpr uint8_t address = DS3231_TEMP_REG; };      //!< Temperature, integer part
+struct TempLSB      { static constexpr uint8_t address = DS3231_TEMP_REG + 1; };  //!< Temperature, fractional part
+
+struct Mode12h  : bits<Hours, 6, 1> {};   //!< 12-hour mode select
+struct PM20h    : bits<Hours, 5, 1> {};   //!< PM in 12-hour mode, 20 hour in 24-hour mode
+struct Century  : bits<Month, 7, 1> {};   //!< Century bit
+
+struct A1M1     : bits<A1Seconds, 7, 1> {}; //!< Alarm 1 seconds mask
+struct A1M2     : bits<A1Minutes, 7, 1> {}; //!< Alarm 1 minutes mask
+struct A1M3     : bits<A1Hours, 7, 1> {};   //!< Alarm 1 hours mask
+struct A1M4     : bits<A1Day, 7, 1> {};     //!< Alarm 1 day mask
+struct A1DYDT   : bits<A1Day, 6, 1> {};     //!< Alarm 1 day of week select
+struct A2M2     : bits<A2Minutes, 7, 1> {}; //!< Alarm 2 minutes mask
+struct A2M3     : bits<A2Hours, 7, 1> {};   //!< Alarm 2 hours mask
+struct A2M4     : bits<A2Day, 7, 1> {};     //!< Alarm 2 day mask
+struct A2DYDT   : bits<A2Day, 6, 1> {};     //!< Alarm 2 day of week select
+
+struct EOSC     : bits<Control, 7, 1> {};   //!< Oscillator disable
+struct BBSQW    : bits<Control, 6, 1> {};   //!< Battery-backed square wave enable
+struct CONV     : bits<Control, 5, 1> {};   //!< Convert temperature
+struct RS       : bits<Control, 3, 2> {};   //!< Square wave rate select
+struct INTCN    : bits<Control, 2, 1> {};   //!< Interrupt control
+struct A2IE     : bits<Control, 1, 1> {};   //!< Alarm 2 interrupt enable
+struct A1IE     : bits<Control, 0, 1> {};   //!< Alarm 1 interrupt enable
+
+struct OSF      : bits<Status, 7, 1> {};    //!< Oscillator stop flag
+struct EN32KHZ  : bits<Status, 3, 1> {};    //!< 32kHz output enable
+struct BSY      : bits<Status, 2, 1> {};    //!< Busy
+struct A2F      : bits<Status, 1, 1> {};    //!< Alarm 2 flag
+struct A1F      : bits<Status, 0, 1> {};    //!< Alarm 1 flag
+
+struct TempFraction : bits<TempLSB, 6, 2> {}; //!< Temperature in quarter degrees
+
+/**
+ * @brief Typed access to a DS3231 register image, e.g. reg<Control>::field<RS>::get(image).
+ *
+ * @tparam Reg The register descriptor.
+ */
+template <typename Reg>
+struct reg
+{
+  static constexpr uint8_t address = Reg::address; //!< The register address
+
+  /**
+   * @brief Accessor for a single field of the register.
+   *
+   * @tparam Field The field descriptor, which must belong to Reg.
+   */
+  template <typename Field>
+  struct field
+  {
+    static_assert(std::is_same<typename Field::reg_type, Reg>::value, "field does not belong to this register");
+
+    static constexpr uint8_t mask = Field::mask;    //!< Mask of the field in the register
+    static constexpr uint8_t shift = Field::shift;  //!< Position of the least significant bit
+
+    /**
+     * @brief Extract the field from a register image.
+     */
+    static constexpr uint8_t get(uint8_t image)
+    {
+      return static_cast<uint8_t>((image & mask) >> shift);
+    }
+
+    /**
+     * @brief Return the register image with the field replaced by value. Bits of value outside the field are dropped.
+     */
+    static constexpr uint8_t set(uint8_t image, uint8_t value)
+    {
+      return static_cast<uint8_t>((image & ~mask) | ((value << shift) & mask));
+    }
+
+    /**
+     * @brief Return the register image with the field replaced by a value checked at compile time.
+     */
+    template <uint8_t Value>
+    static constexpr uint8_t set(uint8_t image)
+    {
+      static_assert((Value >> Field::width) == 0, "value does not fit in field");
+      return set(image, Value);
+    }
+  };
+};
+
+/**
+ * @brief Read a single field from the DS3231.
+ *
+ * @tparam Field The field descriptor, e.g. RS.
+ */
+template <typename Field>
+esp_err_t read(DS3231_Cfg_t cfg, uint8_t& value, TickType_t timeout)
+{
+  uint8_t image;
+  esp_err_t res = ds3231_read_raw(cfg, Field::reg_type::address, &image, sizeof(image), timeout);
+  if (res == ESP_OK)
+    value = reg<typename Field::reg_type>::template field<Field>::get(image);
+  return res;
+}
+
+/**
+ * @brief Read-modify-write a single field on the DS3231.
+ *
+ * @tparam Field The field descriptor, e.g. RS.
+ */
+template <typename Field>
+esp_err_t write(DS3231_Cfg_t cfg, uint8_t value, TickType_t timeout)
+{
+  uint8_t image;
+  esp_err_t res = ds3231_read_raw(cfg, Field::reg_type::address, &image, sizeof(image), timeout);
+  if (res != ESP_OK)
+    return res;
+
+  image = reg<typename Field::reg_type>::template field<Field>::set(image, value);
+  return ds3231_write_raw(cfg, Field::reg_type::address, &image, sizeof(image), timeout);
+}
+
+/**
+ * @brief Convert a binary value 0-99 to BCD.
+ */
+constexpr uint8_t to_bcd(uint8_t value)
+{
+  return static_cast<uint8_t>(((value / 10) << 4) | (value % 10));
+}
+
+/**
+ * @brief Convert a BCD value to binary.
+ */
+constexpr uint8_t from_bcd(uint8_t bcd)
+{
+  return static_cast<uint8_t>((bcd >> 4) * 10 + (bcd & 0x0F));
+}
+
+/**
+ * @brief Whether year is a leap year.
+ */
+constexpr bool is_leap_year(uint16_t year)
+{
+  return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0;
+}
+
+/**
+ * @brief Number of days in the month of year, or 0 if month is not 1-12.
+ */
+constexpr uint8_t days_in_month(uint16_t year, uint8_t month)
+{
+  return month == 2 ? (is_leap_year(year) ? 29 : 28)
+       : month == 4 || month == 6 || month == 9 || month == 11 ? 30
+       : month >= 1 && month <= 12 ? 31
+       : 0;
+}
+
+/**
+ * @brief Whether hour is valid for the clock type.
+ */
+constexpr bool is_valid_hour(DS3231_ClockType_t clock_type, uint8_t hour)
+{
+  return clock_type == DS3231_ClockType_12_Hour ? hour >= 1 && hour <= 12 : hour <= 23;
+}
+
+/**
+ * @brief Build a calendar which is validated at compile time.
+ */
+template <uint16_t Year, uint8_t Month, uint8_t DayOfMonth, uint8_t Hour, uint8_t Minute, uint8_t Second,
+          uint8_t DayOfWeek, DS3231_ClockType_t ClockType = DS3231_ClockType_24_Hour, DS3231_AM_PM_t AmPm = DS3231_AM>
+constexpr DS3231_Calendar_t calendar()
+{
+  static_assert(Year >= 2000 && Year <= 2199, "year must be 2000-2199");
+  static_assert(Month >= 1 && Month <= 12, "month must be 1-12");
+  static_assert(DayOfMonth >= 1 && DayOfMonth <= days_in_month(Year, Month), "day of month is not in month");
+  static_assert(is_valid_hour(ClockType, Hour), "hour must be 0-23 for 24-hour clock or 1-12 for 12-hour clock");
+  static_assert(Minute <= 59, "minute must be 0-59");
+  static_assert(Second <= 59, "second must be 0-59");
+  static_assert(DayOfWeek >= 1 && DayOfWeek <= 7, "day of week must be 1-7");
+
+  return DS3231_Calendar_t{Second, Minute, Hour, DayOfWeek, DayOfMonth, Month, Year, ClockType, AmPm};
+}
+
+/**
+ * @brief Fields of an alarm, as the mask bits of its registers.
+ */
+enum class AlarmField : uint8_t
+{
+  Seconds = 0x01,
+  Minutes = 0x02,
+  Hours = 0x04,
+  Day = 0x08,
+};
+
+/**
+ * @brief Whether an alarm with the rate compares a field. Fields it does not compare are ignored by the chip, and by
+ * ds3231_alarm_validate, so they may be left at 0.
+ */
+constexpr bool alarm_compares(DS3231_AlarmType_t type, DS3231_AlarmRate_t rate, AlarmField field)
+{
+  // alarm 2 has no seconds register, so its rates are the alarm 1 masks shifted down by one
+  return ((type == DS3231_AlarmType_Alarm2 ? rate << 1 : rate) & static_cast<uint8_t>(field)) == 0;
+}
+
+/**
+ * @brief Whether the hour and am_pm of an alarm are valid for the clock type.
+ */
+constexpr bool is_valid_alarm_hour(DS3231_ClockType_t clock_type, DS3231_AM_PM_t am_pm, uint8_t hour)
+{
+  return clock_type == DS3231_ClockType_12_Hour ? (am_pm == DS3231_AM || am_pm == DS3231_PM) && hour >= 1 && hour <= 12
+       : clock_type == DS3231_ClockType_24_Hour ? hour <= 23
+       : false;
+}
+
+/**
+ * @brief Whether the day of an alarm is valid for the day type.
+ */
+constexpr bool is_valid_alarm_day(DS3231_AlarmDayType_t day_type, uint8_t day)
+{
+  return day_type == DS3231_AlarmDayType_DayOfWeek ? day >= 1 && day <= 7
+       : day_type == DS3231_AlarmDayType_DayOfMonth ? day >= 1 && day <= 31
+       : false;
+}
+
+/**
+ * @brief Build an alarm 1 setting which is validated at compile time. As with ds3231_alarm_validate, only the fields
+ * compared by Rate are checked.
+ */
+template <DS3231_AlarmRate_t Rate, uint8_t Second = 0, uint8_t Minute = 0, uint8_t Hour = 0, uint8_t Day = 1,
+          DS3231_AlarmDayType_t DayType = DS3231_AlarmDayType_DayOfMonth,
+          DS3231_ClockType_t ClockType = DS3231_ClockType_24_Hour, DS3231_AM_PM_t AmPm = DS3231_AM>
+constexpr DS3231_AlarmSetting_t alarm1()
+{
+  constexpr DS3231_AlarmType_t type = DS3231_AlarmType_Alarm1;
+  static_assert(Rate == DS3231_AlarmRate_PerSecond || Rate == DS3231_AlarmRate_S_Match ||
+                Rate == DS3231_AlarmRate_MS_Match || Rate == DS3231_AlarmRate_HMS_Match ||
+                Rate == DS3231_AlarmRate_DHMS_Match, "rate is not supported by alarm 1");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Seconds) || Second <= 59, "second must be 0-59");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Minutes) || Minute <= 59, "minute must be 0-59");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Hours) || is_valid_alarm_hour(ClockType, AmPm, Hour),
+                "hour must be 0-23 for 24-hour clock or 1-12 AM/PM for 12-hour clock");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Day) || is_valid_alarm_day(DayType, Day),
+                "day must be 1-7 for day of week or 1-31 for day of month");
+
+  return DS3231_AlarmSetting_t{Second, Minute, Hour, Day, type, ClockType, AmPm, DayType, Rate};
+}
+
+/**
+ * @brief Build an alarm 2 setting which is validated at compile time. As with ds3231_alarm_validate, only the fields
+ * compared by Rate are checked.
+ */
+template <DS3231_AlarmRate_t Rate, uint8_t Minute = 0, uint8_t Hour = 0, uint8_t Day = 1,
+          DS3231_AlarmDayType_t DayType = DS3231_AlarmDayType_DayOfMonth,
+          DS3231_ClockType_t ClockType = DS3231_ClockType_24_Hour, DS3231_AM_PM_t AmPm = DS3231_AM>
+constexpr DS3231_AlarmSetting_t alarm2()
+{
+  constexpr DS3231_AlarmType_t type = DS3231_AlarmType_Alarm2;
+  static_assert(Rate == DS3231_AlarmRate_PerMinute || Rate == DS3231_AlarmRate_M_Match ||
+                Rate == DS3231_AlarmRate_HM_Match || Rate == DS3231_AlarmRate_DHM_Match,
+                "rate is not supported by alarm 2");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Minutes) || Minute <= 59, "minute must be 0-59");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Hours) || is_valid_alarm_hour(ClockType, AmPm, Hour),
+                "hour must be 0-23 for 24-hour clock or 1-12 AM/PM for 12-hour clock");
+  static_assert(!alarm_compares(type, Rate, AlarmField::Day) || is_valid_alarm_day(DayType, Day),
+                "day must be 1-7 for day of week or 1-31 for day of month");
+
+  return DS3231_AlarmSetting_t{0, Minute, Hour, Day, type, ClockType, AmPm, DayType, Rate};
+}
+
+} // namespace ds3231
+
+#endif // __DS3231_HPP__
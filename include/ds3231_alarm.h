@@ -0,0 +1,63 @@
+/*!
+ * @file
+ * @brief Validation of alarm settings and calculation of when an alarm will fire.
+ *
+ * This module is pure computation and does not communicate with the DS3231.
+ */
+#ifndef __DS3231_ALARM_H__
+#define __DS3231_ALARM_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ds3231_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reason an alarm setting is invalid.
+ */
+typedef enum
+{
+  DS3231_AlarmError_None,     //!< The alarm setting is valid
+  DS3231_AlarmError_Type,     //!< alarm_type is neither alarm 1 nor alarm 2
+  DS3231_AlarmError_Rate,     //!< alarm_rate is not supported by the alarm
+  DS3231_AlarmError_Seconds,  //!< seconds is not 0-59, or not 0 for alarm 2
+  DS3231_AlarmError_Minutes,  //!< minutes is not 0-59
+  DS3231_AlarmError_Hour,     //!< hour is not 0-23 on the 24-hour clock or 1-12 on the 12-hour clock
+  DS3231_AlarmError_ClockType,//!< clock_type or am_pm is not a valid value
+  DS3231_AlarmError_Day,      //!< day is not 1-7 for day of week or 1-31 for day of month
+  DS3231_AlarmError_DayType,  //!< day_type is not a valid value
+  DS3231_AlarmError_Calendar  //!< The calendar passed to ds3231_alarm_next is invalid
+} DS3231_AlarmError_t;
+
+/**
+ * @brief Check that an alarm setting is one the DS3231 can represent. Only the fields compared by alarm_rate are
+ * checked; the others, e.g. day and hour for DS3231_AlarmRate_MS_Match, are ignored and may be left at 0.
+ *
+ * @param[in] alarm The alarm setting to check.
+ * @return DS3231_AlarmError_None if the alarm setting is valid.
+ */
+DS3231_AlarmError_t ds3231_alarm_validate(const DS3231_AlarmSetting_t* alarm);
+
+/**
+ * @brief Calculate the next times an alarm will fire. Each fire time is calculated in constant time.
+ *
+ * Fire times are in seconds since the Unix epoch, treating the calendar as UTC. Alarms matching on day of week use
+ * now->day_of_week as the current day of week, since the DS3231 day of week is user defined.
+ *
+ * @param[in] alarm The alarm setting.
+ * @param[in] now The current calendar of the DS3231.
+ * @param[out] fire The array to populate with the next count fire times after now, in ascending order.
+ * @param count The number of fire times to calculate.
+ * @return DS3231_AlarmError_None on success, otherwise the reason the alarm or calendar is invalid.
+ */
+DS3231_AlarmError_t ds3231_alarm_next(const DS3231_AlarmSetting_t* alarm, const DS3231_Calendar_t* now,
+                                      int64_t* fire, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_ALARM_H__
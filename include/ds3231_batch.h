@@ -0,0 +1,33 @@
+/*!
+ * @file
+ * @brief Batch conversion of logged calendar register images to Unix epoch seconds.
+ *
+ * This module has no dependency on ESP-IDF and is intended for post-processing logs on a host.
+ */
+#ifndef __DS3231_BATCH_H__
+#define __DS3231_BATCH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <ds3231_regs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Convert an array of calendar register images, as read by ds3231_read_raw from DS3231_CAL_REG, to seconds since
+ * the Unix epoch. The result for each image is identical to ds3231_raw_calendar_to_epoch.
+ *
+ * @param[in] images The first calendar register image.
+ * @param stride The distance in bytes between consecutive images, at least DS3231_CAL_LEN.
+ * @param[out] epoch The array of count epoch values to populate.
+ * @param count The number of images to convert.
+ */
+void ds3231_batch_calendar_to_epoch(const uint8_t* images, size_t stride, int64_t* epoch, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_BATCH_H__
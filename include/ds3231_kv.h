@@ -0,0 +1,94 @@
+/*!
+ * @file
+ * @brief Log-structured key-value store in the battery-backed SRAM of the DS3232.
+ *
+ * The SRAM is split into two banks. The bank in use starts with a header of [magic][version][generation][crc8],
+ * followed by records appended as [key][len][value][crc8] and an end marker, so updating a value writes only the new
+ * record. A record with len 0 deletes the key. When the bank is full the live records are copied to the other bank,
+ * which is then switched to by writing its header with the next generation. The whole SRAM is cached in DS3231_Cfg_t,
+ * so lookups do not touch the bus.
+ *
+ * A power failure or bus error loses at most the update being made: a record interrupted part way through writing
+ * fails its CRC and is discarded the next time the store is mounted, and an interrupted compaction leaves the old bank
+ * in use.
+ *
+ * The calls may be made from several tasks. They are serialised by a lock in DS3231_Cfg_t, which the calls taking a
+ * timeout wait for up to that long before returning ESP_ERR_TIMEOUT; ds3231_kv_get waits as long as an update takes.
+ */
+#ifndef __DS3231_KV_H__
+#define __DS3231_KV_H__
+
+#include <ds3231.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS3231_KV_END        0xFF                    //!< Key reserved for the end marker
+#define DS3231_KV_OVERHEAD   3                       //!< Bytes used by a record in addition to its value
+#define DS3231_KV_HEADER_LEN 4                       //!< Bytes used by the header of a bank
+#define DS3231_KV_BANK_LEN   (DS3232_SRAM_LEN / 2)   //!< Size of each of the two banks
+//! Largest value, leaving room for the header and the end marker
+#define DS3231_KV_MAX_VALUE  (DS3231_KV_BANK_LEN - DS3231_KV_HEADER_LEN - DS3231_KV_OVERHEAD - 1)
+
+/**
+ * @brief Read the DS3232 SRAM into a cache and locate the end of the store. Call ds3231_detect_variant first. SRAM
+ * without a valid bank header, e.g. after the first power up, reads as an empty store, which is formatted by the first
+ * update. The cache is freed by ds3231_delete.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param timeout The number of ticks to wait for the DS3232 to respond.
+ * @return esp_err_t ESP_ERR_NOT_SUPPORTED if the chip has not been detected as a DS3232.
+ */
+esp_err_t ds3231_kv_mount(DS3231_Cfg_t cfg, TickType_t timeout);
+
+/**
+ * @brief Delete every key. Like compaction, this switches to the other bank, so it is not lost to a power failure.
+ * 
+ * @param cfg The configuration of the DS3231 component, with the store mounted.
+ * @param timeout The number of ticks to wait for the DS3232 to respond.
+ * @return esp_err_t 
+ */
+esp_err_t ds3231_kv_format(DS3231_Cfg_t cfg, TickType_t timeout);
+
+/**
+ * @brief Look up a key in the cache.
+ * 
+ * @param cfg The configuration of the DS3231 component, with the store mounted.
+ * @param key The key, 0-254.
+ * @param[out] value Buffer for the value.
+ * @param[in,out] len The size of value on input and the length of the value on output.
+ * @return esp_err_t ESP_ERR_NOT_FOUND if the key is not set, ESP_ERR_INVALID_SIZE if value is too small, in which case
+ * len is set to the length needed.
+ */
+esp_err_t ds3231_kv_get(DS3231_Cfg_t cfg, uint8_t key, void* value, size_t* len);
+
+/**
+ * @brief Set a key. Nothing is written if the value is unchanged; otherwise the new record is written in one burst, or
+ * with the live records to the other bank if the bank in use is full.
+ * 
+ * @param cfg The configuration of the DS3231 component, with the store mounted.
+ * @param key The key, 0-254.
+ * @param value The value.
+ * @param len The length of the value, 1 to DS3231_KV_MAX_VALUE.
+ * @param timeout The number of ticks to wait for the DS3232 to respond.
+ * @return esp_err_t ESP_ERR_NO_MEM if the live records and the new value do not fit. After a bus error the store must
+ * be mounted again.
+ */
+esp_err_t ds3231_kv_set(DS3231_Cfg_t cfg, uint8_t key, const void* value, size_t len, TickType_t timeout);
+
+/**
+ * @brief Delete a key.
+ * 
+ * @param cfg The configuration of the DS3231 component, with the store mounted.
+ * @param key The key, 0-254.
+ * @param timeout The number of ticks to wait for the DS3232 to respond.
+ * @return esp_err_t ESP_ERR_NOT_FOUND if the key is not set. After a bus error the store must be mounted again.
+ */
+esp_err_t ds3231_kv_delete(DS3231_Cfg_t cfg, uint8_t key, TickType_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_KV_H__
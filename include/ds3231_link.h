@@ -0,0 +1,86 @@
+/*!
+ * @file
+ * @brief Characterisation of the i2c link to the DS3231 and selection of the fastest reliable clock speed.
+ */
+#ifndef __DS3231_LINK_H__
+#define __DS3231_LINK_H__
+
+#include <ds3231.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Statistics from characterising the link at one clock speed.
+ */
+typedef struct
+{
+  uint32_t clk_speed;       //!< The clock speed in Hz, 0 if the current speed was not changed
+  uint32_t transfers;       //!< Number of transfers made
+  uint32_t errors;          //!< Number of transfers which returned an error
+  uint32_t mismatches;      //!< Number of reads which did not return the data written
+  uint32_t latency_avg_us;  //!< Mean time per transfer in microseconds
+  uint32_t latency_max_us;  //!< Longest transfer in microseconds
+} DS3231_LinkResult_t;
+
+/**
+ * @brief Changes the i2c clock speed, e.g. by calling i2c_param_config with the application's i2c_config_t.
+ *
+ * @param arg User argument from DS3231_LinkTuneCfg_t.
+ * @param clk_speed The clock speed in Hz.
+ * @return esp_err_t 
+ */
+typedef esp_err_t (*DS3231_SetClkSpeed_t)(void* arg, uint32_t clk_speed);
+
+/**
+ * @brief Configuration for ds3231_link_tune.
+ */
+typedef struct
+{
+  const uint32_t* clk_speeds;         //!< Clock speeds to try in Hz
+  size_t clk_speed_count;             //!< Number of entries in clk_speeds
+  uint32_t iterations;                //!< Verification patterns to run at each speed; each is four transfers
+  DS3231_SetClkSpeed_t set_clk_speed; //!< Changes the clock speed; NULL to use the backend, if it supports it
+  void* arg;                          //!< User argument for set_clk_speed
+  uint32_t initial_clk_speed;         //!< Speed in use before tuning; 0 for the backend's, or else the slowest
+} DS3231_LinkTuneCfg_t;
+
+/**
+ * @brief Characterise the link at the current clock speed. Patterns are written to and read back from the alarm and
+ * aging offset registers, which are restored afterwards. Alarm interrupts are disabled while the test runs and any
+ * alarm flag raised by the patterns is cleared; an alarm which genuinely fires during the test may be lost.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param iterations The number of verification patterns to run; each is four transfers.
+ * @param[out] result The statistics of the test.
+ * @param timeout The number of ticks to wait for the DS3231 to respond to each transfer.
+ * @return esp_err_t ESP_OK if the test ran and the registers were restored, regardless of errors counted in result.
+ */
+esp_err_t ds3231_link_characterize(DS3231_Cfg_t cfg, uint32_t iterations, DS3231_LinkResult_t* result,
+                                   TickType_t timeout);
+
+/**
+ * @brief Characterise the link at each clock speed and select the fastest with no errors or mismatches. The registers
+ * used are saved, and restored after going back to the initial clock speed, before the selected speed is applied.
+ *
+ * Tuning is not locked as a whole: no other task may use this DS3231, or another device on the bus whose speed
+ * set_clk_speed changes, until it returns. The same holds for ds3231_link_characterize.
+ * 
+ * @param cfg The configuration of the DS3231 component.
+ * @param tune The clock speeds to try and how to apply them.
+ * @param[out] results Array of tune->clk_speed_count results, one per clock speed, in the order given. All entries are
+ * written; those for speeds not reached after an error have no transfers.
+ * @param[out] best_clk_speed The selected clock speed, which is left applied.
+ * @param timeout The number of ticks to wait for the DS3231 to respond to each transfer.
+ * @return esp_err_t ESP_ERR_NOT_FOUND if no speed was reliable, in which case the slowest speed is left applied. On other
+ * errors the initial speed is left applied if it could be.
+ */
+esp_err_t ds3231_link_tune(DS3231_Cfg_t cfg, const DS3231_LinkTuneCfg_t* tune, DS3231_LinkResult_t* results,
+                           uint32_t* best_clk_speed, TickType_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_LINK_H__
@@ -0,0 +1,34 @@
+/*!
+ * @file
+ * @brief Definitions normally provided by ESP-IDF and FreeRTOS, used when building the driver for Linux.
+ *
+ * Ticks are milliseconds and the i2c port is the adapter number N of /dev/i2c-N.
+ */
+#ifndef __DS3231_LINUX_H__
+#define __DS3231_LINUX_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;          //!< Error code, as esp_err_t in ESP-IDF
+typedef uint32_t TickType_t;    //!< Timeout in milliseconds
+typedef int i2c_port_t;         //!< Adapter number N of /dev/i2c-N
+
+#define ESP_OK                  0       //!< Success
+#define ESP_FAIL                -1      //!< Generic failure, including a NACK from the DS3231
+#define ESP_ERR_NO_MEM          0x101   //!< Out of memory
+#define ESP_ERR_INVALID_ARG     0x102   //!< Invalid argument
+#define ESP_ERR_INVALID_STATE   0x103   //!< Invalid state
+#define ESP_ERR_INVALID_SIZE    0x104   //!< Invalid size
+#define ESP_ERR_NOT_FOUND       0x105   //!< Requested resource not found
+#define ESP_ERR_NOT_SUPPORTED   0x106   //!< Operation not supported by the adapter
+#define ESP_ERR_TIMEOUT         0x107   //!< Operation timed out
+
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))  //!< Convert milliseconds to ticks
+#define portMAX_DELAY           ((TickType_t)0xFFFFFFFF) //!< Wait forever
+
+#define I2C_NUM_0               0       //!< /dev/i2c-0
+#define I2C_NUM_1               1       //!< /dev/i2c-1
+
+#endif // __DS3231_LINUX_H__
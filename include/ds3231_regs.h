@@ -0,0 +1,175 @@
+/*!
+ * @file
+ * @brief DS3231 register map and inline helpers for decoding raw register images in place.
+ *
+ * This header has no dependencies beyond the C standard library so that register images captured on the device can
+ * be decoded on any host.
+ */
+#ifndef __DS3231_REGS_H__
+#define __DS3231_REGS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS3231_ADDR       0x68  //!< I2C address of the DS3231
+#define DS3231_CAL_REG    0x00  //!< First calendar register (seconds)
+#define DS3231_ALM1_REG   0x07  //!< First alarm 1 register (seconds)
+#define DS3231_ALM2_REG   0x0B  //!< First alarm 2 register (minutes)
+#define DS3231_CTRL_REG   0x0E  //!< Control register
+#define DS3231_CS_REG     0x0F  //!< Control/status register
+#define DS3231_AGE_REG    0x10  //!< Aging offset register
+#define DS3231_TEMP_REG   0x11  //!< First temperature register (integer part)
+#define DS3231_REG_COUNT  0x13  //!< Number of registers in the DS3231 register map
+#define DS3232_SRAM_REG   0x14  //!< First byte of the DS3232 battery-backed SRAM
+#define DS3232_REG_COUNT  0x100 //!< Number of registers in the DS3232 register map, including SRAM
+
+#define DS3232_CS_CRATE   0x30  //!< DS3232 temperature conversion rate bits in the control/status register
+
+#define DS3231_CAL_LEN    7     //!< Size in bytes of the calendar register image
+#define DS3231_ALM1_LEN   4     //!< Size in bytes of the alarm 1 register image
+#define DS3231_ALM2_LEN   3     //!< Size in bytes of the alarm 2 register image
+#define DS3231_TEMP_LEN   2     //!< Size in bytes of the temperature register image
+#define DS3232_SRAM_LEN   (DS3232_REG_COUNT - DS3232_SRAM_REG)  //!< Size in bytes of the DS3232 SRAM
+
+/**
+ * @brief Decode a BCD byte to binary.
+ */
+static inline uint8_t ds3231_bcd_decode(uint8_t bcd)
+{
+  return (bcd >> 4) * 10 + (bcd & 0x0F);
+}
+
+/**
+ * @brief Encode a binary value 0-99 as BCD.
+ */
+static inline uint8_t ds3231_bcd_encode(uint8_t value)
+{
+  return ((value / 10) << 4) | (value % 10);
+}
+
+/**
+ * @brief Seconds 0-59 from a calendar register image.
+ */
+static inline uint8_t ds3231_raw_seconds(const uint8_t* cal)
+{
+  return ds3231_bcd_decode(cal[0] & 0x7F);
+}
+
+/**
+ * @brief Minutes 0-59 from a calendar register image.
+ */
+static inline uint8_t ds3231_raw_minutes(const uint8_t* cal)
+{
+  return ds3231_bcd_decode(cal[1] & 0x7F);
+}
+
+/**
+ * @brief Whether the calendar register image is using the 12-hour clock.
+ */
+static inline bool ds3231_raw_is_12h(const uint8_t* cal)
+{
+  return (cal[2] & 0x40) != 0;
+}
+
+/**
+ * @brief Whether the calendar register image is PM. Only meaningful when using the 12-hour clock.
+ */
+static inline bool ds3231_raw_is_pm(const uint8_t* cal)
+{
+  return ds3231_raw_is_12h(cal) && (cal[2] & 0x20) != 0;
+}
+
+/**
+ * @brief Hour as stored in a calendar register image, 1-12 for the 12-hour clock or 0-23 for the 24-hour clock.
+ */
+static inline uint8_t ds3231_raw_hour(const uint8_t* cal)
+{
+  return ds3231_raw_is_12h(cal) ? ds3231_bcd_decode(cal[2] & 0x1F) : ds3231_bcd_decode(cal[2] & 0x3F);
+}
+
+/**
+ * @brief Hour 0-23 from a calendar register image regardless of which clock it is using.
+ */
+static inline uint8_t ds3231_raw_hour24(const uint8_t* cal)
+{
+  uint8_t hour = ds3231_raw_hour(cal);
+  if (ds3231_raw_is_12h(cal))
+    hour = hour % 12 + (ds3231_raw_is_pm(cal) ? 12 : 0);
+  return hour;
+}
+
+/**
+ * @brief User defined day of week 1-7 from a calendar register image.
+ */
+static inline uint8_t ds3231_raw_day_of_week(const uint8_t* cal)
+{
+  return cal[3] & 0x07;
+}
+
+/**
+ * @brief Day of month 1-31 from a calendar register image.
+ */
+static inline uint8_t ds3231_raw_day_of_month(const uint8_t* cal)
+{
+  return ds3231_bcd_decode(cal[4] & 0x3F);
+}
+
+/**
+ * @brief Month 1-12 from a calendar register image.
+ */
+static inline uint8_t ds3231_raw_month(const uint8_t* cal)
+{
+  return ds3231_bcd_decode(cal[5] & 0x1F);
+}
+
+/**
+ * @brief Year 2000-2199 from a calendar register image.
+ */
+static inline uint16_t ds3231_raw_year(const uint8_t* cal)
+{
+  return 2000 + ((cal[5] & 0x80) ? 100 : 0) + ds3231_bcd_decode(cal[6]);
+}
+
+/**
+ * @brief Temperature in quarter degrees Celsius from a temperature register image.
+ */
+static inline int16_t ds3231_raw_temperature_q2(const uint8_t* temp)
+{
+  return (int16_t)((int8_t)temp[0] * 4 + (temp[1] >> 6));
+}
+
+/**
+ * @brief Days since 1970-01-01 for a date in the proleptic Gregorian calendar.
+ *
+ * @param year The year.
+ * @param month The month 1-12.
+ * @param day The day of month 1-31.
+ */
+static inline int32_t ds3231_days_from_civil(int32_t year, uint32_t month, uint32_t day)
+{
+  year -= month <= 2;
+  const int32_t era = (year >= 0 ? year : year - 399) / 400;
+  const uint32_t yoe = (uint32_t)(year - era * 400);
+  const uint32_t doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+/**
+ * @brief Seconds since the Unix epoch from a calendar register image, treating the calendar as UTC.
+ */
+static inline int64_t ds3231_raw_calendar_to_epoch(const uint8_t* cal)
+{
+  int64_t days = ds3231_days_from_civil(ds3231_raw_year(cal), ds3231_raw_month(cal), ds3231_raw_day_of_month(cal));
+  return days * 86400 + ds3231_raw_hour24(cal) * 3600 + ds3231_raw_minutes(cal) * 60 + ds3231_raw_seconds(cal);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_REGS_H__
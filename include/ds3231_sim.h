@@ -0,0 +1,47 @@
+/*!
+ * @file
+ * @brief Simulated DS3231 for host builds.
+ *
+ * The ds3231_sim library is the Linux build of the driver with the bus replaced by a register file. ds3231_create
+ * ignores the port and returns a chip in its power-on state. Writes follow the chip's rules: the temperature and BSY
+ * are read-only, OSF and the alarm flags are only cleared by writing 0, a conversion started with CONV completes
+ * immediately and the DS3231M ignores RS. The clock does not run; set the calendar with ds3231_sim_regs.
+ */
+#ifndef __DS3231_SIM_H__
+#define __DS3231_SIM_H__
+#include <ds3231.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Select the part simulated. The default is DS3231_Variant_DS3231.
+ *
+ * @param cfg DS3231 configuration returned by ds3231_create.
+ * @param variant The part to simulate.
+ */
+void ds3231_sim_set_variant(DS3231_Cfg_t cfg, DS3231_Variant_t variant);
+
+/**
+ * @brief Simulate a power failure or bus error part way through a write. Once bytes more registers have been written,
+ * the write in progress stops and fails with ESP_FAIL, as does every later write.
+ *
+ * @param cfg DS3231 configuration returned by ds3231_create.
+ * @param bytes The number of registers which may still be written, or SIZE_MAX to stop failing writes.
+ */
+void ds3231_sim_fail_writes_after(DS3231_Cfg_t cfg, size_t bytes);
+
+/**
+ * @brief The simulated register file, DS3232_REG_COUNT bytes. Changes made through it bypass the write rules.
+ *
+ * @param cfg DS3231 configuration returned by ds3231_create.
+ * @return The registers.
+ */
+uint8_t* ds3231_sim_regs(DS3231_Cfg_t cfg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_SIM_H__
@@ -0,0 +1,48 @@
+/*!
+ * @file
+ * @brief Conversion between DS3231_Calendar_t and seconds since the Unix epoch.
+ *
+ * The DS3231 keeps no time zone, so calendars are converted as if they were UTC.
+ */
+#ifndef __DS3231_TIME_H__
+#define __DS3231_TIME_H__
+
+#include <stdint.h>
+#include <ds3231_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Convert an hour on either clock to 0-23.
+ */
+static inline uint8_t ds3231_hour24(DS3231_ClockType_t clock_type, DS3231_AM_PM_t am_pm, uint8_t hour)
+{
+  if (clock_type == DS3231_ClockType_12_Hour)
+    return hour % 12 + (am_pm == DS3231_PM ? 12 : 0);
+  return hour;
+}
+
+/**
+ * @brief Seconds since the Unix epoch for a calendar.
+ *
+ * @param[in] calendar The calendar; day_of_week is ignored.
+ * @return The number of seconds since 1970-01-01 00:00:00.
+ */
+int64_t ds3231_calendar_to_epoch(const DS3231_Calendar_t* calendar);
+
+/**
+ * @brief Calendar for seconds since the Unix epoch, using the 24-hour clock. Since the DS3231 day of week is user
+ * defined, day_of_week is set to the ISO 8601 weekday, 1 for Monday to 7 for Sunday.
+ *
+ * @param epoch The number of seconds since 1970-01-01 00:00:00.
+ * @param[out] calendar The calendar to populate.
+ */
+void ds3231_epoch_to_calendar(int64_t epoch, DS3231_Calendar_t* calendar);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_TIME_H__
@@ -0,0 +1,192 @@
+/*!
+ * @file
+ * @brief Timebase counting edges of the DS3231 square wave output, resynchronised against the calendar registers.
+ *
+ * The square wave is derived from the DS3231's temperature compensated oscillator, so a count of its edges is a far
+ * more stable clock than the ESP32's internal RC oscillator. Edges are counted by ds3231_timebase_edge_from_isr, called
+ * from a GPIO interrupt (see ds3231_timebase_attach_gpio) or, on a host, from any simulated edge source. The GPIO
+ * interrupt also wakes the chip from light sleep, so the count continues across it, and with
+ * CONFIG_DS3231_TIMEBASE_TICKLESS the FreeRTOS tick is stepped by the edges counted during automatic light sleep.
+ */
+#ifndef __DS3231_TIMEBASE_H__
+#define __DS3231_TIMEBASE_H__
+
+#include <ds3231.h>
+
+#ifdef ESP_PLATFORM
+#include <driver/gpio.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Edge counter and the calendar time it was last synchronised to. Owned by the caller.
+ */
+typedef struct
+{
+  uint64_t edges;         //!< Edges counted; only updated through ds3231_timebase_edge_from_isr
+  uint32_t freq_hz;       //!< Square wave frequency
+  bool synced;            //!< Whether ds3231_timebase_resync has succeeded
+  uint64_t sync_edges;    //!< Edge count at the second boundary of sync_epoch
+  int64_t sync_epoch;     //!< Calendar time at sync_edges in seconds since the Unix epoch
+  int64_t sync_local_us;  //!< Local monotonic time at sync_edges
+  int32_t edge_error;     //!< Edges counted minus edges expected from the calendar at the last resync
+  uint32_t edge_tolerance;//!< Uncertainty of the last resync in edges, from polling the seconds register
+  int32_t local_ppm;      //!< Error of the local monotonic clock against the square wave over the last resync interval
+  uint64_t edge_stamp;    //!< Low 32 bits of the edge count and of the local time of the last edge, if recorded
+  int64_t sleep_carry;    //!< Time slept but not yet stepped, in microseconds times the tick rate
+#ifdef ESP_PLATFORM
+  gpio_num_t gpio;        //!< The GPIO attached with ds3231_timebase_attach_gpio
+  uint32_t gpio_level;    //!< The level the GPIO interrupt is armed for
+#endif
+} DS3231_Timebase_t;
+
+/**
+ * @brief Count one square wave edge. Safe to call from an interrupt handler or another thread.
+ */
+static inline void ds3231_timebase_edge_from_isr(DS3231_Timebase_t* tb)
+{
+  __atomic_fetch_add(&tb->edges, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Count one square wave edge and record when it happened, which lets ds3231_timebase_position_us interpolate
+ * between edges. Safe to call from an interrupt handler or another thread.
+ *
+ * @param tb The timebase.
+ * @param local_us The local monotonic time of the edge: esp_timer_get_time, or CLOCK_MONOTONIC on Linux.
+ */
+static inline void ds3231_timebase_edge_at_from_isr(DS3231_Timebase_t* tb, int64_t local_us)
+{
+  // one store, so a reader sees the count and time of the same edge or a stamp that does not match the count
+  const uint64_t edges = __atomic_add_fetch(&tb->edges, 1, __ATOMIC_RELAXED);
+  __atomic_store_n(&tb->edge_stamp, (edges << 32) | (uint32_t)local_us, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief The number of edges counted so far.
+ */
+static inline uint64_t ds3231_timebase_edges(const DS3231_Timebase_t* tb)
+{
+  return __atomic_load_n(&tb->edges, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief Reset the timebase, then configure the DS3231 to output the square wave on INT/SQW. Alarm interrupts cannot be
+ * signalled on the pin while the square wave is being output.
+ * 
+ * @param tb The timebase to initialise.
+ * @param cfg The configuration of the DS3231 component.
+ * @param square_wave_setting The square wave frequency; 1Hz wakes the CPU least often, higher rates give finer resolution.
+ * @param timeout The number of ticks to wait for the DS3231 to respond.
+ * @return esp_err_t 
+ */
+esp_err_t ds3231_timebase_init(DS3231_Timebase_t* tb, DS3231_Cfg_t cfg, DS3231_SquareWave_t square_wave_setting,
+                               TickType_t timeout);
+
+/**
+ * @brief Align the edge count with the calendar by polling the seconds register until it changes. The first call
+ * establishes the timeline; later calls measure edge_error and local_ppm and only move the timeline if edges were lost
+ * or gained beyond the polling uncertainty. Must not be called concurrently with the other functions reading the
+ * timeline, and takes up to one second.
+ * 
+ * @param tb The timebase, with edges being counted.
+ * @param cfg The configuration of the DS3231 component.
+ * @param timeout The number of ticks to wait for the DS3231 to respond to each read.
+ * @return esp_err_t ESP_ERR_TIMEOUT if the seconds register did not change, e.g. the oscillator is stopped.
+ */
+esp_err_t ds3231_timebase_resync(DS3231_Timebase_t* tb, DS3231_Cfg_t cfg, TickType_t timeout);
+
+/**
+ * @brief Calendar time derived from the edge count, in microseconds since the Unix epoch. Resolution is one edge.
+ * 
+ * @param tb A timebase which has been synchronised.
+ * @return int64_t 
+ */
+int64_t ds3231_timebase_now_us(const DS3231_Timebase_t* tb);
+
+/**
+ * @brief Whole ticks of a tick_hz clock elapsed since *mark, for long software timers or for vTaskStepTick in an
+ * application's tickless idle hook. The fraction of a tick not returned is carried in *mark, so repeated calls do not accumulate rounding error.
+ * 
+ * @param tb The timebase.
+ * @param[in,out] mark Opaque position, initialised with ds3231_timebase_mark.
+ * @param tick_hz The tick rate, e.g. configTICK_RATE_HZ.
+ * @return uint32_t 
+ */
+uint32_t ds3231_timebase_elapsed_ticks(const DS3231_Timebase_t* tb, uint64_t* mark, uint32_t tick_hz);
+
+/**
+ * @brief Initialise a mark for ds3231_timebase_elapsed_ticks at the current edge count.
+ */
+static inline uint64_t ds3231_timebase_mark(const DS3231_Timebase_t* tb, uint32_t tick_hz)
+{
+  return ds3231_timebase_edges(tb) * tick_hz;
+}
+
+/**
+ * @brief Time on the timebase in microseconds since the count started: whole edges, plus the local time since the last
+ * edge when the edge source records it with ds3231_timebase_edge_at_from_isr. The local clock only interpolates within
+ * one edge period, so its drift does not accumulate.
+ *
+ * @param tb The timebase.
+ * @param local_us The current local monotonic time, from the same clock as the edge times.
+ * @return int64_t
+ */
+int64_t ds3231_timebase_position_us(const DS3231_Timebase_t* tb, int64_t local_us);
+
+/**
+ * @brief Whole ticks elapsed between two positions taken before and after a sleep, for vTaskStepTick. The fraction of
+ * a tick not returned is carried into the next call, so repeated short sleeps do not lose time.
+ *
+ * @param tb The timebase.
+ * @param start_us ds3231_timebase_position_us before the sleep.
+ * @param end_us ds3231_timebase_position_us after the sleep.
+ * @param tick_hz The tick rate, e.g. configTICK_RATE_HZ.
+ * @param max_ticks The most ticks that may be stepped, i.e. the expected idle time; the carry is dropped at the limit.
+ * @return uint32_t
+ */
+uint32_t ds3231_timebase_slept_ticks(DS3231_Timebase_t* tb, int64_t start_us, int64_t end_us, uint32_t tick_hz,
+                                     uint32_t max_ticks);
+
+#ifdef ESP_PLATFORM
+/**
+ * @brief Count falling edges on a GPIO connected to INT/SQW, awake and in light sleep. Installs the shared GPIO ISR
+ * service if needed and enables GPIO wakeup. The pin needs a pull-up as INT/SQW is open drain.
+ *
+ * Only level interrupts wake the chip, so the interrupt is armed for the level the pin is not at and re-armed for the
+ * other level on each change. Every change wakes the chip, twice per square wave period; use 1Hz with light sleep.
+ *
+ * @param tb The timebase.
+ * @param gpio The GPIO connected to INT/SQW.
+ * @return esp_err_t 
+ */
+esp_err_t ds3231_timebase_attach_gpio(DS3231_Timebase_t* tb, gpio_num_t gpio);
+
+/**
+ * @brief Stop counting edges on a GPIO and disable its wakeup.
+ * 
+ * @param gpio The GPIO passed to ds3231_timebase_attach_gpio.
+ * @return esp_err_t 
+ */
+esp_err_t ds3231_timebase_detach_gpio(gpio_num_t gpio);
+
+#ifdef CONFIG_DS3231_TIMEBASE_TICKLESS
+/**
+ * @brief Step the FreeRTOS tick by the square wave after each automatic light sleep instead of by the RTC slow clock.
+ * esp_pm still decides when and how long to sleep. The timebase must be counting edges with
+ * ds3231_timebase_attach_gpio.
+ *
+ * @param tb The timebase, or NULL to go back to esp_pm's own step.
+ */
+void ds3231_timebase_set_tickless(DS3231_Timebase_t* tb);
+#endif
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_TIMEBASE_H__
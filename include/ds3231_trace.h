@@ -0,0 +1,146 @@
+/*!
+ * @file
+ * @brief Record every register transfer the driver makes into a compact binary trace.
+ *
+ * The trace starts with the 4 byte magic "D3TR" and a version byte, followed by one record per transfer:
+ * a flags byte, the register, then varints of the data length, the microseconds since the previous record started, the
+ * duration of the transfer and, if it failed, the zigzag encoded error. Last come the data written, or the data read
+ * when the read succeeded. A calendar read within 16 ms of the previous transfer takes 14 bytes.
+ *
+ * tools/ds3231_trace_replay.c replays the raw transfers of a trace against a simulated chip, see ds3231_sim.h, and
+ * reports transaction counts, redundant reads and timing. The ds3231_* calls which made the transfers are not recorded,
+ * so are not replayed.
+ *
+ * Transfers started with ds3231_read_raw_async and ds3231_write_raw_async are not recorded.
+ */
+#ifndef __DS3231_TRACE_H__
+#define __DS3231_TRACE_H__
+#include <ds3231.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS3231_TRACE_HEADER_LEN 5   //!< Size of the magic and version at the start of a trace
+#define DS3231_TRACE_MAX_RECORD 280 //!< Largest encoded record in bytes, a 256 byte transfer that failed
+
+#define DS3231_TRACE_WRITE 0x01 //!< Record flag: the transfer was a write
+#define DS3231_TRACE_ERROR 0x02 //!< Record flag: the transfer failed and the error follows the duration
+
+/**
+ * @brief Called by the writer to store trace data. Consecutive calls continue the same stream, starting with the
+ * header. Runs in the task making the transfer with the trace locked, so it must not use the DS3231 being traced.
+ *
+ * @param arg User argument given to ds3231_trace_writer_init.
+ * @param data The bytes to append to the trace.
+ * @param len The number of bytes.
+ * @return 0 on success; on failure the data is kept and the record that did not fit is dropped.
+ */
+typedef int (*DS3231_TraceFlush_t)(void* arg, const uint8_t* data, size_t len);
+
+/**
+ * @brief State of a trace writer.
+ */
+typedef struct
+{
+  uint8_t* buf;               //!< Buffer holding records not yet flushed
+  size_t size;                //!< Size of buf in bytes
+  size_t used;                //!< Bytes used in buf
+  int64_t last_us;            //!< Start time of the last record, or of the trace
+  DS3231_TraceFlush_t flush;  //!< Callback to store full buffers, or NULL to stop recording when buf is full
+  void* arg;                  //!< User argument for flush
+  uint32_t records;           //!< Number of records written
+  uint32_t dropped;           //!< Number of records that did not fit
+  DS3231_Cfg_t cfg;           //!< DS3231 recording into the writer, set by ds3231_trace_start
+} DS3231_TraceWriter_t;
+
+/**
+ * @brief A decoded trace record.
+ */
+typedef struct
+{
+  bool write;             //!< True for a write, false for a read
+  uint8_t reg;            //!< First register transferred
+  size_t len;             //!< Number of registers transferred
+  const uint8_t* data;    //!< len bytes written or read, or NULL for a failed read
+  esp_err_t res;          //!< Result of the transfer
+  int64_t time_us;        //!< Start of the transfer in microseconds from the start of the trace
+  uint32_t duration_us;   //!< Duration of the transfer in microseconds
+} DS3231_TraceRecord_t;
+
+/**
+ * @brief State of a trace reader.
+ */
+typedef struct
+{
+  const uint8_t* data;  //!< The trace being read
+  size_t size;          //!< Size of the trace in bytes
+  size_t pos;           //!< Offset of the next record
+  int64_t time_us;      //!< Start time of the last record decoded
+  bool corrupt;         //!< Set when decoding stopped at a truncated or invalid record
+} DS3231_TraceReader_t;
+
+/**
+ * @brief Initialise a writer and put the trace header in its buffer.
+ *
+ * @param[out] writer The writer to initialise.
+ * @param buf Buffer of size bytes. With a flush callback it must hold at least DS3231_TRACE_MAX_RECORD bytes.
+ * @param size The size of buf.
+ * @param flush Callback which stores the buffer when it is full, or NULL to keep the records that fit in buf.
+ * @param arg User argument passed to flush.
+ * @return esp_err_t ESP_ERR_INVALID_SIZE if buf cannot hold the header, or a record when flush is given.
+ */
+esp_err_t ds3231_trace_writer_init(DS3231_TraceWriter_t* writer, uint8_t* buf, size_t size, DS3231_TraceFlush_t flush,
+                                   void* arg);
+
+/**
+ * @brief Pass the buffered records to flush. While recording, safe to call from any task except from flush itself.
+ *
+ * @param writer The writer.
+ * @return 0 on success, or the value returned by flush.
+ */
+int ds3231_trace_sync(DS3231_TraceWriter_t* writer);
+
+/**
+ * @brief Record every transfer made with cfg into writer until ds3231_trace_stop. Transfers from several tasks are
+ * recorded in the order they finish.
+ *
+ * @param cfg DS3231 configuration.
+ * @param writer The writer, which must stay valid while recording.
+ */
+void ds3231_trace_start(DS3231_Cfg_t cfg, DS3231_TraceWriter_t* writer);
+
+/**
+ * @brief Stop recording. Records still buffered are not flushed, see ds3231_trace_sync.
+ *
+ * @param cfg DS3231 configuration.
+ */
+void ds3231_trace_stop(DS3231_Cfg_t cfg);
+
+/**
+ * @brief Initialise a reader over a complete trace.
+ *
+ * @param[out] reader The reader to initialise.
+ * @param data The trace, starting with its header.
+ * @param size The size of the trace in bytes.
+ * @return true if the header is valid.
+ */
+bool ds3231_trace_reader_init(DS3231_TraceReader_t* reader, const uint8_t* data, size_t size);
+
+/**
+ * @brief Decode the next record. A truncated or invalid record ends the trace and sets reader->corrupt.
+ *
+ * @param reader The reader.
+ * @param[out] record The decoded record; data points into the trace.
+ * @return true if a record was decoded, false at the end of the trace.
+ */
+bool ds3231_trace_next(DS3231_TraceReader_t* reader, DS3231_TraceRecord_t* record);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_TRACE_H__
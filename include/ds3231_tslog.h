@@ -0,0 +1,145 @@
+/*!
+ * @file
+ * @brief Compact, delta encoded timestamp log.
+ *
+ * Timestamps are stored in fixed size blocks. Each block starts with an absolute epoch, followed by zigzag varint
+ * deltas, so any block can be decoded on its own. Unused bytes at the end of a block are left as 0xFF, the erased
+ * state of NOR flash, which never forms a complete entry. A timestamp one to a few minutes after the last takes one or
+ * two bytes instead of the ten used by DS3231_Calendar_t.
+ *
+ * A block stored early by ds3231_tslog_sync can be continued after a reset with ds3231_tslog_writer_resume; otherwise
+ * each writer starts a new block.
+ *
+ * This module has no dependency on ESP-IDF so the same code reads the log on a host.
+ */
+#ifndef __DS3231_TSLOG_H__
+#define __DS3231_TSLOG_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ds3231_regs.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DS3231_TSLOG_MAX_ENTRY 10 //!< Largest encoded entry in bytes; blocks must be larger than this
+#define DS3231_TSLOG_ERR_RANGE (-1) //!< Returned for a timestamp outside +-2^62 seconds, which cannot be encoded
+
+/**
+ * @brief Called by the writer to store a block.
+ *
+ * @param arg User argument given to ds3231_tslog_writer_init.
+ * @param block The block, always block_size bytes with unused bytes set to 0xFF.
+ * @param block_size The size of the block.
+ * @param complete True if the block is full and the next call will be for a new block. False if the block was
+ * written early by ds3231_tslog_sync and will be written again, with more entries, at the same location.
+ * @return 0 on success; any other value is returned to the caller of the writer.
+ */
+typedef int (*DS3231_TsLogFlush_t)(void* arg, const uint8_t* block, size_t block_size, bool complete);
+
+/**
+ * @brief State of a timestamp log writer.
+ */
+typedef struct
+{
+  uint8_t* block;             //!< Buffer holding the block being filled
+  size_t block_size;          //!< Size of a block in bytes
+  size_t used;                //!< Bytes used in the current block
+  int64_t last;               //!< The last timestamp appended
+  DS3231_TsLogFlush_t flush;  //!< Callback to store a block
+  void* arg;                  //!< User argument for flush
+} DS3231_TsLogWriter_t;
+
+/**
+ * @brief State of a timestamp log reader.
+ */
+typedef struct
+{
+  const uint8_t* data;  //!< The log being read
+  size_t size;          //!< Size of the log in bytes
+  size_t block_size;    //!< Size of a block in bytes
+  size_t pos;           //!< Offset of the next entry
+  int64_t last;         //!< The last timestamp decoded
+  uint32_t errors;      //!< Number of blocks abandoned due to corruption
+} DS3231_TsLogReader_t;
+
+/**
+ * @brief Initialise a writer.
+ *
+ * @param[out] writer The writer to initialise.
+ * @param block Buffer of block_size bytes used to assemble each block.
+ * @param block_size The size of a block, greater than DS3231_TSLOG_MAX_ENTRY.
+ * @param flush Callback which stores a block.
+ * @param arg User argument passed to flush.
+ */
+void ds3231_tslog_writer_init(DS3231_TsLogWriter_t* writer, uint8_t* block, size_t block_size,
+                              DS3231_TsLogFlush_t flush, void* arg);
+
+/**
+ * @brief Initialise a writer which continues a block stored by ds3231_tslog_sync, e.g. after a reset. Entries are
+ * appended after those already in the block, and it is written again at the same location.
+ *
+ * @param[out] writer The writer to initialise.
+ * @param block Buffer of block_size bytes holding the block as last stored.
+ * @param block_size The size of a block, greater than DS3231_TSLOG_MAX_ENTRY.
+ * @param flush Callback which stores a block.
+ * @param arg User argument passed to flush.
+ * @return true if the block is continued. false if it is corrupt; the writer then starts an empty block, which should
+ * be stored at the next location so the damaged block is kept.
+ */
+bool ds3231_tslog_writer_resume(DS3231_TsLogWriter_t* writer, uint8_t* block, size_t block_size,
+                                DS3231_TsLogFlush_t flush, void* arg);
+
+/**
+ * @brief Append a timestamp to the log.
+ *
+ * @param writer The writer.
+ * @param epoch Seconds since the Unix epoch, within +-2^62.
+ * @return 0 on success, DS3231_TSLOG_ERR_RANGE if epoch is out of range, or the value returned by a failed flush.
+ */
+int ds3231_tslog_append(DS3231_TsLogWriter_t* writer, int64_t epoch);
+
+/**
+ * @brief Append a calendar register image, as read by ds3231_read_raw from DS3231_CAL_REG, to the log.
+ *
+ * @param writer The writer.
+ * @param cal The calendar register image.
+ * @return 0 on success or the value returned by a failed flush.
+ */
+int ds3231_tslog_append_raw(DS3231_TsLogWriter_t* writer, const uint8_t* cal);
+
+/**
+ * @brief Store the partially filled block so entries survive a reset. The block will be written again at the same
+ * location when it fills up.
+ *
+ * @param writer The writer.
+ * @return 0 on success or the value returned by flush.
+ */
+int ds3231_tslog_sync(DS3231_TsLogWriter_t* writer);
+
+/**
+ * @brief Initialise a reader over a log made up of whole blocks.
+ *
+ * @param[out] reader The reader to initialise.
+ * @param data The log.
+ * @param size The size of the log in bytes.
+ * @param block_size The block size used by the writer.
+ */
+void ds3231_tslog_reader_init(DS3231_TsLogReader_t* reader, const uint8_t* data, size_t size, size_t block_size);
+
+/**
+ * @brief Decode the next timestamp. Corrupt blocks are skipped and counted in reader->errors.
+ *
+ * @param reader The reader.
+ * @param[out] epoch The decoded timestamp.
+ * @return true if a timestamp was decoded, false at the end of the log.
+ */
+bool ds3231_tslog_next(DS3231_TsLogReader_t* reader, int64_t* epoch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_TSLOG_H__
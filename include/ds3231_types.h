@@ -0,0 +1,173 @@
+/*!
+ * @file
+ * @brief Types shared by the DS3231 driver and its platform independent modules.
+ */
+#ifndef __DS3231_TYPES_H__
+#define __DS3231_TYPES_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum DS3231_ClockType_t
+ * @brief Defines use of 12 or 24 hour clock.
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_ClockType_24_Hour, //!< 24 Hour Clock
+  DS3231_ClockType_12_Hour  //!< 12 Hour Clock
+} DS3231_ClockType_t;
+
+/**
+ * @enum DS3231_AM_PM_t
+ * @brief AM and PM values for 12 Hour Clock
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_AM,    //!< AM
+  DS3231_PM     //!< PM
+} DS3231_AM_PM_t;
+
+/**
+ * @brief Structure for DS3231 Calendar
+ */
+typedef struct
+{
+  uint8_t seconds;                //!< Seconds in the minute 0-59
+  uint8_t minutes;                //!< Minutes in the hour 0-59
+  uint8_t hour;                   //!< The hour of the day, 0-23 for 24-hour clock, 1-12 for 12 hour clock
+  uint8_t day_of_week;            //!< User defined day of week, 1-7
+  uint8_t day_of_month;           //!< Day of the month, 1-31
+  uint8_t month;                  //!< Month of the year 1-12
+  uint16_t year;                  //!< The year, 2000-2199
+  DS3231_ClockType_t clock_type;  //!< The type of the clock, either 12 or 24-hour clock. Defines how hour is interpreted
+  DS3231_AM_PM_t am_pm;           //!< Either AM or PM. Only used when clock type is 12-hour clock
+} DS3231_Calendar_t;
+
+/**
+ * @enum DS3231_AlarmDayType_t
+ * @brief Defines how to interpret DS3231_AlarmSetting_t.day
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_AlarmDayType_DayOfMonth, //!< Day is day of month 1-31
+  DS3231_AlarmDayType_DayOfWeek   //!< Day is day of week 1-7
+} DS3231_AlarmDayType_t;
+
+/**
+ * @enum DS3231_AlarmRate_t
+ * @brief The rate at which the alarm will be fired. 
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_AlarmRate_PerSecond  = 0x0F, //!< Once per second (Alarm 1)
+  DS3231_AlarmRate_S_Match    = 0x0E, //!< Seconds Match (Alarm 1)
+  DS3231_AlarmRate_MS_Match   = 0x0C, //!< Minutes and Seconds Match (Alarm 1)
+  DS3231_AlarmRate_HMS_Match  = 0x08, //!< Hours, Minutes, and Seconds Match (Alarm 1)
+  DS3231_AlarmRate_DHMS_Match = 0x00, //!< Day, Hours, Minutes, and Seconds Match (Alarm 1)
+
+  DS3231_AlarmRate_PerMinute  = 0x07, //!< Once per minute (Alarm 2)
+  DS3231_AlarmRate_M_Match    = 0x06, //!< Minutes Match (Alarm 2)
+  DS3231_AlarmRate_HM_Match   = 0x04, //!< Hours and Minutes Match (Alarm 2)
+  DS3231_AlarmRate_DHM_Match  = 0x00, //!< Day, Hours, and Minutes Match (Alarm 2)
+} DS3231_AlarmRate_t;
+
+/**
+ * @brief The selection of alarm in DS3231_AlarmSetting_t
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_AlarmType_Alarm1 = 1, //!< Use Alarm 1
+  DS3231_AlarmType_Alarm2 = 2  //!< Use Alarm 2
+} DS3231_AlarmType_t;
+
+/**
+ * @brief Alarm configuration.
+ */
+typedef struct
+{
+  uint8_t seconds;                  //!< The seconds on which the alarm should match. Alarm 1 only.
+  uint8_t minutes;                  //!< The minutes on which the alarm should match.
+  uint8_t hour;                     //!< The hour on which the alarm should match.
+  uint8_t day;                      //!< The day on which the alarm should match; day_type defines whether this is day of week or day of month.
+
+  DS3231_AlarmType_t alarm_type;    //!< Selection of alarm 1 or alarm 2.
+  DS3231_ClockType_t clock_type;    //!< Whether alarm hour should be interpreted on a 12 or 24-hour clock
+  DS3231_AM_PM_t am_pm;             //!< If clock_type == DS3231_ClockType_12_Hour then this defines whether the hour is AM or PM.
+  DS3231_AlarmDayType_t day_type;   //!< Flag for whether day is day of week or day of month
+  DS3231_AlarmRate_t alarm_rate;    //!< The alarm rate on which the alarm will fire.
+} DS3231_AlarmSetting_t;
+
+/**
+ * @brief Flags for interrupt enable or interrupt fired.
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_Interrupt_None     = 0x00, //!< No interrupts enabled or no interrupt fired.
+  DS3231_Interrupt_Alarm_1  = 0x01, //!< Alarm 1 interrupt enable or Alarm 1 interrupt fired.
+  DS3231_Interrupt_Alarm_2  = 0x02  //!< Alarm 1 interrupt enable or Alarm 2 interrupt fired.
+} DS3231_Interrupt_t;
+
+/**
+ * @brief Square wave frequencies
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_SquareWave_1Hz     = 0x00, //!< Output 1Hz square wave
+  DS3231_SquareWave_1024Hz  = 0x01, //!< Output 1024Hz square wave
+  DS3231_SquareWave_4096Hz  = 0x02, //!< Output 4096Hz square wave
+  DS3231_SquareWave_8192Hz  = 0x03, //!< Output 8192Hz square wave
+  DS3231_SquareWave_Off     = 0xFF  //!< Disable square wave generation
+} DS3231_SquareWave_t;
+
+/**
+ * @brief Flag for enabling the oscillator.
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_Oscillator_Enable  = 0,  //!< Oscillator is enabled
+  DS3231_Oscillator_Disable = 1   //!< Oscillator is disabled
+} DS3231_Oscillator_t;
+
+/**
+ * @brief Flag for enabling the 32kHz signal generation
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_32kHz_Disable  = 0,  //!< 32kHz signal generation is disabled
+  DS3231_32kHz_Enable   = 1   //!< 32kHz signal generation is enabled
+} DS3231_32kHz_t;
+
+/**
+ * @brief Chip variants sharing the DS3231 register map.
+ */
+typedef enum __attribute__((__packed__))
+{
+  DS3231_Variant_DS3231   = 0,  //!< DS3231, or a chip which could not be told apart from it
+  DS3231_Variant_DS3231M  = 1,  //!< DS3231M, with a fixed 1Hz square wave
+  DS3231_Variant_DS3232   = 2   //!< DS3232, with 236 bytes of battery-backed SRAM at DS3232_SRAM_REG
+} DS3231_Variant_t;
+
+/**
+ * @brief Desired state of the alarm, control, status and aging offset registers, applied by ds3231_apply_config.
+ * Each field has the same meaning as the argument of the corresponding ds3231_set_* function.
+ */
+typedef struct
+{
+  const DS3231_AlarmSetting_t* alarm1;  //!< Alarm 1 setting, or NULL to leave the alarm 1 registers unchanged
+  const DS3231_AlarmSetting_t* alarm2;  //!< Alarm 2 setting, or NULL to leave the alarm 2 registers unchanged
+  DS3231_Oscillator_t oscillator;       //!< Oscillator enable, as ds3231_set_osc
+  DS3231_Interrupt_t intr_en;           //!< Alarm interrupt enables, as ds3231_set_intr_en; the square wave is only output on INT/SQW when this is DS3231_Interrupt_None
+  DS3231_SquareWave_t square_wave;      //!< Square wave frequency, as ds3231_set_square_wave
+  DS3231_32kHz_t en_32kHz;              //!< 32kHz output enable, as ds3231_set_32kHz
+  uint8_t aging_offset;                 //!< Aging offset, as ds3231_set_aging_offset
+} DS3231_Config_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_TYPES_H__
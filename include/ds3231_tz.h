@@ -0,0 +1,112 @@
+/*!
+ * @file
+ * @brief Local time from a POSIX TZ rule, for use with the zone-less DS3231 calendar.
+ *
+ * A TZ rule such as "CET-1CEST,M3.5.0,M10.5.0/3" is parsed once into a table of UTC transitions for a range of years.
+ * Conversions then check the interval found by the previous lookup and only binary search the table when the time
+ * has moved outside it. Times outside the table are calculated directly from the rule.
+ *
+ * A compiled zone may be shared by several tasks. The cached interval is updated without a lock but is never seen torn;
+ * a lookup that races an update searches the table instead of using the cache.
+ *
+ * This module is pure computation and has no dependency on ESP-IDF or the C library time functions.
+ */
+#ifndef __DS3231_TZ_H__
+#define __DS3231_TZ_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <ds3231_types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A change of UTC offset.
+ */
+typedef struct
+{
+  int64_t at;       //!< Seconds since the Unix epoch, UTC, at which offset takes effect
+  int32_t offset;   //!< Seconds east of UTC from this transition
+} DS3231_TzTransition_t;
+
+/**
+ * @brief When daylight saving time starts or ends within a year.
+ */
+typedef struct
+{
+  char type;        //!< 'M' for month.week.day, 'J' for Julian day 1-365 without leap day, 'D' for day 0-365
+  uint16_t day;     //!< Day of week 0-6 for 'M', otherwise day of year
+  uint8_t week;     //!< Week 1-5 of the month for 'M', 5 being the last
+  uint8_t month;    //!< Month 1-12 for 'M'
+  int32_t time;     //!< Local time of day of the change in seconds, may be negative or beyond 24 hours
+} DS3231_TzRule_t;
+
+/**
+ * @brief A compiled time zone.
+ */
+typedef struct DS3231_Tz
+{
+  int32_t std_offset;               //!< Standard time offset in seconds east of UTC
+  int32_t dst_offset;               //!< Daylight saving time offset in seconds east of UTC
+  bool has_dst;                     //!< Whether the zone observes daylight saving time
+  DS3231_TzRule_t start;            //!< Start of daylight saving time, in local standard time
+  DS3231_TzRule_t end;              //!< End of daylight saving time, in local daylight saving time
+  DS3231_TzTransition_t* table;     //!< Precomputed transitions in ascending order
+  size_t count;                     //!< Number of transitions in table
+  int64_t cache_start;              //!< Start of the interval found by the last lookup
+  int64_t cache_end;                //!< End (exclusive) of the interval found by the last lookup
+  int32_t cache_offset;             //!< Offset in effect during the cached interval
+  uint32_t cache_seq;               //!< Odd while the cached interval is being updated
+} DS3231_Tz_t;
+
+/**
+ * @brief Parse a POSIX TZ rule and precompute its transitions.
+ *
+ * @param[out] tz The time zone to initialise.
+ * @param posix_tz The TZ rule, e.g. "EST5EDT,M3.2.0,M11.1.0".
+ * @param first_year The first year to precompute, e.g. the current year.
+ * @param last_year The last year to precompute.
+ * @param table Storage for the transitions, two per year; must remain valid while tz is used.
+ * @param capacity The number of entries in table. Years which do not fit are calculated on demand.
+ * @return true if posix_tz was parsed.
+ */
+bool ds3231_tz_compile(DS3231_Tz_t* tz, const char* posix_tz, uint16_t first_year, uint16_t last_year,
+                       DS3231_TzTransition_t* table, size_t capacity);
+
+/**
+ * @brief The offset from UTC in effect at a time.
+ *
+ * @param tz The time zone.
+ * @param utc Seconds since the Unix epoch.
+ * @return Seconds east of UTC.
+ */
+int32_t ds3231_tz_offset(DS3231_Tz_t* tz, int64_t utc);
+
+/**
+ * @brief Convert UTC to local time.
+ */
+static inline int64_t ds3231_tz_to_local(DS3231_Tz_t* tz, int64_t utc)
+{
+  return utc + ds3231_tz_offset(tz, utc);
+}
+
+/**
+ * @brief Convert local time to UTC. A time repeated when daylight saving time ends resolves to the first occurrence;
+ * a time skipped when it starts is interpreted with the standard time offset.
+ */
+int64_t ds3231_tz_to_utc(DS3231_Tz_t* tz, int64_t local);
+
+/**
+ * @brief Convert a UTC calendar, as kept by the DS3231, to a local calendar on the 24-hour clock. day_of_week is the
+ * ISO 8601 weekday.
+ */
+void ds3231_tz_local_calendar(DS3231_Tz_t* tz, const DS3231_Calendar_t* utc, DS3231_Calendar_t* local);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DS3231_TZ_H__
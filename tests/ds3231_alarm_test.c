@@ -0,0 +1,381 @@
+/*
+ * Host test of ds3231_alarm_validate and ds3231_alarm_next for every alarm rate, with the fields the rate does not
+ * compare left at 0, on the 24-hour and 12-hour clocks and from month, leap day and year ends. Fire times are checked
+ * against a search second by second, for fixed alarms and for random alarms from random calendars. Settings the chip
+ * cannot represent are checked to be rejected with the field at fault.
+ */
+#include <ds3231_alarm.h>
+#include <ds3231_time.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#define MASK_SECONDS 0x01
+#define MASK_MINUTES 0x02
+#define MASK_HOURS   0x04
+#define MASK_DAY     0x08
+#define FIRE_COUNT   4
+#define RANDOM_COUNT 400
+
+typedef struct
+{
+  DS3231_AlarmType_t type;
+  DS3231_AlarmRate_t rate;
+  const char* name;
+} Rate_t;
+
+static const Rate_t rates[] = {
+  { DS3231_AlarmType_Alarm1, DS3231_AlarmRate_PerSecond, "PerSecond" },
+  { DS3231_AlarmType_Alarm1, DS3231_AlarmRate_S_Match, "S_Match" },
+  { DS3231_AlarmType_Alarm1, DS3231_AlarmRate_MS_Match, "MS_Match" },
+  { DS3231_AlarmType_Alarm1, DS3231_AlarmRate_HMS_Match, "HMS_Match" },
+  { DS3231_AlarmType_Alarm1, DS3231_AlarmRate_DHMS_Match, "DHMS_Match" },
+  { DS3231_AlarmType_Alarm2, DS3231_AlarmRate_PerMinute, "PerMinute" },
+  { DS3231_AlarmType_Alarm2, DS3231_AlarmRate_M_Match, "M_Match" },
+  { DS3231_AlarmType_Alarm2, DS3231_AlarmRate_HM_Match, "HM_Match" },
+  { DS3231_AlarmType_Alarm2, DS3231_AlarmRate_DHM_Match, "DHM_Match" },
+};
+
+#define RATE_COUNT (sizeof(rates) / sizeof(rates[0]))
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(cond))                                                                                                       \
+    {                                                                                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                      \
+      printf(__VA_ARGS__);                                                                                             \
+      printf("\n");                                                                                                    \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+// Mask bits as in the alarm registers: a set bit means the field is not compared. Alarm 2 always fires at second 0.
+static uint8_t rate_mask(const Rate_t* rate)
+{
+  return rate->type == DS3231_AlarmType_Alarm1 ? rate->rate : (uint8_t)(rate->rate << 1);
+}
+
+// The calendar of the day containing epoch, converted once per day as the search steps a second at a time.
+static const DS3231_Calendar_t* day_calendar(int64_t epoch)
+{
+  static int64_t day = -1;
+  static DS3231_Calendar_t cal;
+  if (epoch / 86400 != day)
+  {
+    day = epoch / 86400;
+    ds3231_epoch_to_calendar(day * 86400, &cal);
+  }
+  return &cal;
+}
+
+static bool day_matches(const DS3231_AlarmSetting_t* alarm, const DS3231_Calendar_t* now, int64_t start,
+                        int64_t epoch)
+{
+  if (alarm->day_type == DS3231_AlarmDayType_DayOfMonth)
+    return day_calendar(epoch)->day_of_month == alarm->day;
+
+  // the day of week is user defined, counted on from now->day_of_week
+  const int64_t days = epoch / 86400 - start / 86400;
+  return (now->day_of_week - 1 + days) % 7 + 1 == alarm->day;
+}
+
+static bool matches(const DS3231_AlarmSetting_t* alarm, uint8_t mask, int64_t epoch)
+{
+  const int seconds = epoch % 60, minutes = epoch / 60 % 60, hour = epoch / 3600 % 24;
+  if (alarm->alarm_type == DS3231_AlarmType_Alarm2 && seconds != 0)
+    return false;
+  if (!(mask & MASK_SECONDS) && seconds != alarm->seconds)
+    return false;
+  if (!(mask & MASK_MINUTES) && minutes != alarm->minutes)
+    return false;
+  if (!(mask & MASK_HOURS))
+  {
+    // 12 AM is midnight and 12 PM is noon
+    if (alarm->clock_type == DS3231_ClockType_12_Hour)
+      return (hour % 12 == 0 ? 12 : hour % 12) == alarm->hour && (hour >= 12) == (alarm->am_pm == DS3231_PM);
+    return hour == alarm->hour;
+  }
+
+  return true;
+}
+
+// Checks the next count fire times against a search second by second, through the days matching the alarm's day;
+// searching up to a year covers day of month 31 skipping the shorter months.
+static void check_next(const char* name, const DS3231_AlarmSetting_t* alarm, uint8_t mask,
+                       const DS3231_Calendar_t* now, size_t count)
+{
+  int64_t fire[FIRE_COUNT];
+  DS3231_AlarmError_t err = ds3231_alarm_next(alarm, now, fire, count);
+  CHECK(err == DS3231_AlarmError_None, "%s: next returned %d", name, err);
+  if (err != DS3231_AlarmError_None)
+    return;
+
+  const int64_t start = ds3231_calendar_to_epoch(now);
+  int64_t t = start;
+  for (size_t i = 0; i < count; i++)
+  {
+    const int64_t limit = t + 366 * 86400;
+    do
+    {
+      t++;
+      if (!(mask & MASK_DAY) && !day_matches(alarm, now, start, t))
+        t = t - t % 86400 + 86399;
+      else if (matches(alarm, mask, t))
+        break;
+    } while (t < limit);
+    CHECK(fire[i] == t, "%s: fire time %zu from %04u-%02u-%02u %02u:%02u:%02u is %lld, expected %lld", name, i,
+          now->year, now->month, now->day_of_month, now->hour, now->minutes, now->seconds, (long long)fire[i],
+          (long long)t);
+  }
+}
+
+static void test_rate(const Rate_t* rate, DS3231_AlarmDayType_t day_type, DS3231_ClockType_t clock_type, uint8_t day,
+                      const DS3231_Calendar_t* now)
+{
+  const uint8_t mask = rate_mask(rate);
+  DS3231_AlarmSetting_t alarm = {
+    .alarm_type = rate->type,
+    .alarm_rate = rate->rate,
+    .clock_type = clock_type,
+    .am_pm = DS3231_AM,
+    .day_type = day_type,
+  };
+  if (!(mask & MASK_SECONDS) && rate->type == DS3231_AlarmType_Alarm1)
+    alarm.seconds = 30;
+  if (!(mask & MASK_MINUTES))
+    alarm.minutes = 15;
+  if (!(mask & MASK_HOURS))
+  {
+    // 6 in the morning on the 24-hour clock, 12 AM (midnight) or 6 PM on the 12-hour clock
+    alarm.hour = clock_type == DS3231_ClockType_12_Hour && day_type == DS3231_AlarmDayType_DayOfWeek ? 12 : 6;
+    alarm.am_pm = clock_type == DS3231_ClockType_12_Hour && day_type == DS3231_AlarmDayType_DayOfMonth ? DS3231_PM
+                                                                                                       : DS3231_AM;
+  }
+  if (!(mask & MASK_DAY))
+    alarm.day = day;
+
+  DS3231_AlarmError_t err = ds3231_alarm_validate(&alarm);
+  CHECK(err == DS3231_AlarmError_None, "%s: validate returned %d", rate->name, err);
+  check_next(rate->name, &alarm, mask, now, FIRE_COUNT);
+}
+
+static void test_rates(void)
+{
+  // the ends of a long month, a leap February, a common February and a year, with a day of week ending the week
+  static const DS3231_Calendar_t starts[] = {
+    { .seconds = 45, .minutes = 20, .hour = 7, .day_of_week = 5, .day_of_month = 30, .month = 1, .year = 2024 },
+    { .seconds = 59, .minutes = 59, .hour = 23, .day_of_week = 3, .day_of_month = 28, .month = 2, .year = 2024 },
+    { .seconds = 0, .minutes = 15, .hour = 6, .day_of_week = 2, .day_of_month = 28, .month = 2, .year = 2023 },
+    { .seconds = 50, .minutes = 59, .hour = 23, .day_of_week = 7, .day_of_month = 31, .month = 12, .year = 2023 },
+    { .seconds = 30, .minutes = 0, .hour = 12, .day_of_week = 1, .day_of_month = 28, .month = 2, .year = 2100 },
+  };
+  static const uint8_t days_of_month[] = { 1, 29, 31 };
+
+  for (size_t s = 0; s < sizeof(starts) / sizeof(starts[0]); s++)
+  {
+    for (size_t i = 0; i < RATE_COUNT; i++)
+    {
+      for (size_t d = 0; d < sizeof(days_of_month); d++)
+      {
+        test_rate(&rates[i], DS3231_AlarmDayType_DayOfMonth, DS3231_ClockType_24_Hour, days_of_month[d], &starts[s]);
+        test_rate(&rates[i], DS3231_AlarmDayType_DayOfMonth, DS3231_ClockType_12_Hour, days_of_month[d], &starts[s]);
+      }
+      for (uint8_t day = 1; day <= 7; day += 6)
+      {
+        test_rate(&rates[i], DS3231_AlarmDayType_DayOfWeek, DS3231_ClockType_24_Hour, day, &starts[s]);
+        test_rate(&rates[i], DS3231_AlarmDayType_DayOfWeek, DS3231_ClockType_12_Hour, day, &starts[s]);
+      }
+    }
+  }
+
+  // a calendar on the 12-hour clock: 12:00:05 AM is five seconds past midnight
+  const DS3231_Calendar_t midnight = {
+    .seconds = 5,
+    .hour = 12,
+    .day_of_week = 1,
+    .day_of_month = 1,
+    .month = 1,
+    .year = 2025,
+    .clock_type = DS3231_ClockType_12_Hour,
+    .am_pm = DS3231_AM,
+  };
+  const DS3231_AlarmSetting_t alarm = {
+    .alarm_type = DS3231_AlarmType_Alarm1,
+    .alarm_rate = DS3231_AlarmRate_HMS_Match,
+    .hour = 12,
+    .clock_type = DS3231_ClockType_12_Hour,
+    .am_pm = DS3231_PM,
+  };
+  int64_t fire;
+  DS3231_AlarmError_t err = ds3231_alarm_next(&alarm, &midnight, &fire, 1);
+  CHECK(err == DS3231_AlarmError_None && fire == ds3231_calendar_to_epoch(&midnight) - 5 + 12 * 3600,
+        "12 PM from 12:00:05 AM returned %d, fire time %lld", err, (long long)fire);
+}
+
+typedef struct
+{
+  DS3231_AlarmSetting_t alarm;
+  DS3231_AlarmError_t err;
+  const char* name;
+} Reject_t;
+
+static void test_reject(void)
+{
+  static const Reject_t rejects[] = {
+    { { .alarm_type = 3, .alarm_rate = DS3231_AlarmRate_PerSecond }, DS3231_AlarmError_Type, "alarm type 3" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1, .alarm_rate = 0x03 }, DS3231_AlarmError_Rate, "alarm 1 rate 0x03" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2, .alarm_rate = DS3231_AlarmRate_MS_Match },
+      DS3231_AlarmError_Rate,
+      "alarm 2 rate MS_Match" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2, .alarm_rate = DS3231_AlarmRate_PerMinute, .seconds = 30 },
+      DS3231_AlarmError_Seconds,
+      "alarm 2 seconds 30" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1, .alarm_rate = DS3231_AlarmRate_S_Match, .seconds = 60 },
+      DS3231_AlarmError_Seconds,
+      "seconds 60" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2, .alarm_rate = DS3231_AlarmRate_M_Match, .minutes = 60 },
+      DS3231_AlarmError_Minutes,
+      "minutes 60" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1, .alarm_rate = DS3231_AlarmRate_HMS_Match, .hour = 24 },
+      DS3231_AlarmError_Hour,
+      "24-hour hour 24" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1,
+        .alarm_rate = DS3231_AlarmRate_HMS_Match,
+        .hour = 0,
+        .clock_type = DS3231_ClockType_12_Hour },
+      DS3231_AlarmError_Hour,
+      "12-hour hour 0" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2,
+        .alarm_rate = DS3231_AlarmRate_HM_Match,
+        .hour = 13,
+        .clock_type = DS3231_ClockType_12_Hour,
+        .am_pm = DS3231_PM },
+      DS3231_AlarmError_Hour,
+      "12-hour hour 13" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2,
+        .alarm_rate = DS3231_AlarmRate_HM_Match,
+        .hour = 6,
+        .clock_type = DS3231_ClockType_12_Hour,
+        .am_pm = 2 },
+      DS3231_AlarmError_ClockType,
+      "am_pm 2" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1, .alarm_rate = DS3231_AlarmRate_HMS_Match, .hour = 6, .clock_type = 2 },
+      DS3231_AlarmError_ClockType,
+      "clock type 2" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1,
+        .alarm_rate = DS3231_AlarmRate_DHMS_Match,
+        .day = 0,
+        .day_type = DS3231_AlarmDayType_DayOfMonth },
+      DS3231_AlarmError_Day,
+      "day of month 0" },
+    { { .alarm_type = DS3231_AlarmType_Alarm1,
+        .alarm_rate = DS3231_AlarmRate_DHMS_Match,
+        .day = 32,
+        .day_type = DS3231_AlarmDayType_DayOfMonth },
+      DS3231_AlarmError_Day,
+      "day of month 32" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2,
+        .alarm_rate = DS3231_AlarmRate_DHM_Match,
+        .day = 8,
+        .day_type = DS3231_AlarmDayType_DayOfWeek },
+      DS3231_AlarmError_Day,
+      "day of week 8" },
+    { { .alarm_type = DS3231_AlarmType_Alarm2, .alarm_rate = DS3231_AlarmRate_DHM_Match, .day = 1, .day_type = 2 },
+      DS3231_AlarmError_DayType,
+      "day type 2" },
+  };
+
+  const DS3231_Calendar_t now = { .day_of_week = 1, .day_of_month = 1, .month = 1, .year = 2024 };
+  int64_t fire;
+  for (size_t i = 0; i < sizeof(rejects) / sizeof(rejects[0]); i++)
+  {
+    DS3231_AlarmError_t err = ds3231_alarm_validate(&rejects[i].alarm);
+    CHECK(err == rejects[i].err, "%s: validate returned %d, expected %d", rejects[i].name, err, rejects[i].err);
+    err = ds3231_alarm_next(&rejects[i].alarm, &now, &fire, 1);
+    CHECK(err == rejects[i].err, "%s: next returned %d, expected %d", rejects[i].name, err, rejects[i].err);
+  }
+
+  // a valid alarm from calendars which are not
+  static const DS3231_Calendar_t bad_now[] = {
+    { .day_of_week = 1, .day_of_month = 29, .month = 2, .year = 2023 },
+    { .day_of_week = 1, .day_of_month = 1, .month = 13, .year = 2024 },
+    { .hour = 0, .day_of_week = 1, .day_of_month = 1, .month = 1, .year = 2024, .clock_type = DS3231_ClockType_12_Hour },
+    { .hour = 24, .day_of_week = 1, .day_of_month = 1, .month = 1, .year = 2024 },
+    { .day_of_week = 0, .day_of_month = 1, .month = 1, .year = 2024 },
+  };
+  const DS3231_AlarmSetting_t alarm = { .alarm_type = DS3231_AlarmType_Alarm1,
+                                        .alarm_rate = DS3231_AlarmRate_PerSecond };
+  for (size_t i = 0; i < sizeof(bad_now) / sizeof(bad_now[0]); i++)
+  {
+    DS3231_AlarmError_t err = ds3231_alarm_next(&alarm, &bad_now[i], &fire, 1);
+    CHECK(err == DS3231_AlarmError_Calendar, "invalid calendar %zu returned %d", i, err);
+  }
+}
+
+// xorshift32, seeded so a failure can be reproduced
+static uint32_t random_state = 0x3231u;
+
+static uint32_t random_below(uint32_t n)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state % n;
+}
+
+static void test_random(void)
+{
+  for (int i = 0; i < RANDOM_COUNT; i++)
+  {
+    const Rate_t* rate = &rates[random_below(RATE_COUNT)];
+    const uint8_t mask = rate_mask(rate);
+    DS3231_AlarmSetting_t alarm = {
+      .alarm_type = rate->type,
+      .alarm_rate = rate->rate,
+      .minutes = random_below(60),
+      .clock_type = random_below(2) ? DS3231_ClockType_12_Hour : DS3231_ClockType_24_Hour,
+      .am_pm = random_below(2) ? DS3231_PM : DS3231_AM,
+      .day_type = random_below(2) ? DS3231_AlarmDayType_DayOfWeek : DS3231_AlarmDayType_DayOfMonth,
+    };
+    if (rate->type == DS3231_AlarmType_Alarm1)
+      alarm.seconds = random_below(60);
+    alarm.hour = alarm.clock_type == DS3231_ClockType_12_Hour ? random_below(12) + 1 : random_below(24);
+    alarm.day = alarm.day_type == DS3231_AlarmDayType_DayOfWeek ? random_below(7) + 1 : random_below(31) + 1;
+
+    // any second from 2000 to 2199, the range of the DS3231 calendar, biased to the last day of a month
+    DS3231_Calendar_t now;
+    int64_t epoch = 946684800 + (int64_t)random_below(200 * 365) * 86400 + random_below(86400);
+    ds3231_epoch_to_calendar(epoch, &now);
+    if (random_below(2))
+    {
+      while (day_calendar(epoch + 86400)->day_of_month != 1)
+        epoch += 86400;
+      ds3231_epoch_to_calendar(epoch, &now);
+    }
+    now.day_of_week = random_below(7) + 1;
+    if (random_below(2))
+    {
+      now.clock_type = DS3231_ClockType_12_Hour;
+      now.am_pm = now.hour >= 12 ? DS3231_PM : DS3231_AM;
+      now.hour = now.hour % 12 == 0 ? 12 : now.hour % 12;
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), "random %d %s %s %s", i, rate->name,
+             alarm.clock_type == DS3231_ClockType_12_Hour ? "12-hour" : "24-hour",
+             alarm.day_type == DS3231_AlarmDayType_DayOfWeek ? "day of week" : "day of month");
+    check_next(name, &alarm, mask, &now, 2);
+  }
+}
+
+int main(void)
+{
+  test_rates();
+  test_reject();
+  test_random();
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
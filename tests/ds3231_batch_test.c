@@ -0,0 +1,152 @@
+/*
+ * Host test of ds3231_batch_calendar_to_epoch against ds3231_raw_calendar_to_epoch. Random calendars are encoded as
+ * the DS3231 stores them, on the 24-hour and 12-hour clocks and with the century bit, along with images of random
+ * bytes. They are converted tightly packed, where the last image ends the buffer, and at a wider stride.
+ */
+#include <ds3231_batch.h>
+#include <ds3231_regs.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE_COUNT 20000
+#define WIDE_STRIDE 16
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(cond))                                                                                                       \
+    {                                                                                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                      \
+      printf(__VA_ARGS__);                                                                                             \
+      printf("\n");                                                                                                    \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+// xorshift32, seeded so a failure can be reproduced
+static uint32_t random_state = 0x3231u;
+
+static uint32_t random_below(uint32_t n)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state % n;
+}
+
+// A calendar the chip could hold, with the unused bits left as the chip reads them, 0.
+static void random_calendar(uint8_t* image)
+{
+  const uint8_t hour = random_below(24);
+  image[0] = ds3231_bcd_encode(random_below(60));
+  image[1] = ds3231_bcd_encode(random_below(60));
+  if (random_below(2))
+  {
+    // 12-hour clock: bit 6 set, bit 5 PM, hour 1-12
+    image[2] = 0x40 | (hour >= 12 ? 0x20 : 0) | ds3231_bcd_encode(hour % 12 == 0 ? 12 : hour % 12);
+  }
+  else
+  {
+    image[2] = ds3231_bcd_encode(hour);
+  }
+  image[3] = random_below(7) + 1;
+  image[4] = ds3231_bcd_encode(random_below(28) + 1);
+  image[5] = ds3231_bcd_encode(random_below(12) + 1) | (random_below(2) ? 0x80 : 0);
+  image[6] = ds3231_bcd_encode(random_below(100));
+}
+
+// Bytes as read from a chip with a corrupt or uninitialised calendar; both conversions must still agree.
+static void random_bytes(uint8_t* image)
+{
+  for (size_t i = 0; i < DS3231_CAL_LEN; i++)
+    image[i] = random_below(256);
+}
+
+static void check_batch(const char* name, const uint8_t* images, size_t stride, size_t count)
+{
+  int64_t* epoch = malloc(count * sizeof(*epoch));
+  if (!epoch)
+  {
+    CHECK(false, "%s: out of memory", name);
+    return;
+  }
+
+  ds3231_batch_calendar_to_epoch(images, stride, epoch, count);
+  int mismatches = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    const uint8_t* image = images + i * stride;
+    const int64_t expected = ds3231_raw_calendar_to_epoch(image);
+    if (epoch[i] != expected && mismatches++ < 5)
+      CHECK(false, "%s: image %zu %02x %02x %02x %02x %02x %02x %02x gives %lld, expected %lld", name, i, image[0],
+            image[1], image[2], image[3], image[4], image[5], image[6], (long long)epoch[i], (long long)expected);
+  }
+  CHECK(mismatches == 0, "%s: %d of %zu images differ", name, mismatches, count);
+  free(epoch);
+}
+
+static void test_images(const char* name, void (*fill)(uint8_t*))
+{
+  // exactly count images, so a load past the last image would leave the buffer
+  uint8_t* packed = malloc(IMAGE_COUNT * DS3231_CAL_LEN);
+  uint8_t* wide = malloc(IMAGE_COUNT * WIDE_STRIDE);
+  if (!packed || !wide)
+  {
+    CHECK(false, "%s: out of memory", name);
+    free(packed);
+    free(wide);
+    return;
+  }
+
+  for (size_t i = 0; i < IMAGE_COUNT; i++)
+  {
+    fill(&packed[i * DS3231_CAL_LEN]);
+    // the bytes between images at the wider stride must not affect the result
+    for (size_t j = 0; j < WIDE_STRIDE; j++)
+      wide[i * WIDE_STRIDE + j] = random_below(256);
+    memcpy(&wide[i * WIDE_STRIDE], &packed[i * DS3231_CAL_LEN], DS3231_CAL_LEN);
+  }
+
+  check_batch(name, packed, DS3231_CAL_LEN, IMAGE_COUNT);
+  check_batch(name, wide, WIDE_STRIDE, IMAGE_COUNT);
+  check_batch(name, &packed[(IMAGE_COUNT - 1) * DS3231_CAL_LEN], DS3231_CAL_LEN, 1);
+  free(packed);
+  free(wide);
+}
+
+static void test_edges(void)
+{
+  // midnight and noon on the 12-hour clock, the first and last seconds of each century and a leap day
+  static const uint8_t images[][DS3231_CAL_LEN] = {
+    { 0x00, 0x00, 0x52, 0x01, 0x01, 0x01, 0x00 }, // 12 AM 2000-01-01
+    { 0x00, 0x00, 0x72, 0x01, 0x01, 0x01, 0x00 }, // 12 PM 2000-01-01
+    { 0x59, 0x59, 0x71, 0x07, 0x31, 0x12, 0x99 }, // 11:59:59 PM 2099-12-31
+    { 0x00, 0x00, 0x00, 0x01, 0x01, 0x81, 0x00 }, // 2100-01-01, century bit
+    { 0x59, 0x59, 0x23, 0x07, 0x31, 0x92, 0x99 }, // 2199-12-31 23:59:59
+    { 0x30, 0x30, 0x12, 0x04, 0x29, 0x02, 0x24 }, // 2024-02-29 12:30:30
+  };
+  static const int64_t expected[] = { 946684800, 946728000, 4102444799, 4102444800, 7258118399, 1709209830 };
+
+  int64_t epoch[sizeof(images) / sizeof(images[0])];
+  ds3231_batch_calendar_to_epoch(images[0], DS3231_CAL_LEN, epoch, sizeof(images) / sizeof(images[0]));
+  for (size_t i = 0; i < sizeof(images) / sizeof(images[0]); i++)
+  {
+    CHECK(epoch[i] == expected[i], "edge %zu gives %lld, expected %lld", i, (long long)epoch[i], (long long)expected[i]);
+    CHECK(ds3231_raw_calendar_to_epoch(images[i]) == expected[i], "edge %zu gives %lld from the scalar decoder", i,
+          (long long)ds3231_raw_calendar_to_epoch(images[i]));
+  }
+}
+
+int main(void)
+{
+  test_edges();
+  test_images("calendars", random_calendar);
+  test_images("random bytes", random_bytes);
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
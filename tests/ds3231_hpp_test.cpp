@@ -0,0 +1,79 @@
+/*
+ * Compile test of the C++ front-end. The builders are instantiated for every alarm rate, with the fields the rate does
+ * not compare left at 0, and the settings are checked against ds3231_alarm_validate. Built with DS3231_HPP_FAIL set to
+ * one of the cases below, it must fail to compile; CMake registers each case as a test expected to fail.
+ */
+#include <ds3231.hpp>
+#include <ds3231_alarm.h>
+#include <cstdio>
+
+// register descriptors follow the C register map
+static_assert(ds3231::Seconds::address == DS3231_CAL_REG, "seconds register");
+static_assert(ds3231::Year::address == DS3231_CAL_REG + DS3231_CAL_LEN - 1, "year register");
+static_assert(ds3231::A1Day::address == DS3231_ALM1_REG + DS3231_ALM1_LEN - 1, "alarm 1 day register");
+static_assert(ds3231::A2Day::address == DS3231_ALM2_REG + DS3231_ALM2_LEN - 1, "alarm 2 day register");
+static_assert(ds3231::TempLSB::address == DS3231_TEMP_REG + DS3231_TEMP_LEN - 1, "temperature LSB register");
+static_assert(ds3231::reg<ds3231::Control>::field<ds3231::RS>::set<DS3231_SquareWave_4096Hz>(0x1C) == 0x14,
+              "rate select field");
+
+#if DS3231_HPP_FAIL == 1
+// alarm 1 compares seconds at S_Match
+constexpr DS3231_AlarmSetting_t invalid = ds3231::alarm1<DS3231_AlarmRate_S_Match, 60>();
+#elif DS3231_HPP_FAIL == 2
+// hour 0 does not exist on the 12-hour clock
+constexpr DS3231_AlarmSetting_t invalid =
+  ds3231::alarm1<DS3231_AlarmRate_HMS_Match, 0, 0, 0, 1, DS3231_AlarmDayType_DayOfMonth, DS3231_ClockType_12_Hour>();
+#elif DS3231_HPP_FAIL == 3
+// hour 13 does not exist on the 12-hour clock
+constexpr DS3231_AlarmSetting_t invalid =
+  ds3231::alarm2<DS3231_AlarmRate_HM_Match, 0, 13, 1, DS3231_AlarmDayType_DayOfMonth, DS3231_ClockType_12_Hour>();
+#elif DS3231_HPP_FAIL == 4
+// day of week 0 at DHM_Match
+constexpr DS3231_AlarmSetting_t invalid =
+  ds3231::alarm2<DS3231_AlarmRate_DHM_Match, 0, 0, 0, DS3231_AlarmDayType_DayOfWeek>();
+#elif DS3231_HPP_FAIL == 5
+// an alarm 1 rate for alarm 2
+constexpr DS3231_AlarmSetting_t invalid = ds3231::alarm2<DS3231_AlarmRate_S_Match>();
+#elif DS3231_HPP_FAIL == 6
+// 29 February 2023
+constexpr DS3231_Calendar_t invalid = ds3231::calendar<2023, 2, 29, 0, 0, 0, 1>();
+#endif
+
+// fields not compared are not checked, as in ds3231_alarm_validate
+constexpr DS3231_AlarmSetting_t alarms[] = {
+  ds3231::alarm1<DS3231_AlarmRate_PerSecond, 0, 0, 0, 0>(),
+  ds3231::alarm1<DS3231_AlarmRate_S_Match, 30, 0, 0, 0>(),
+  ds3231::alarm1<DS3231_AlarmRate_MS_Match, 30, 15, 0, 0>(),
+  ds3231::alarm1<DS3231_AlarmRate_HMS_Match, 30, 15, 6, 0>(),
+  ds3231::alarm1<DS3231_AlarmRate_DHMS_Match, 30, 15, 6, 31>(),
+  ds3231::alarm1<DS3231_AlarmRate_DHMS_Match, 30, 15, 12, 7, DS3231_AlarmDayType_DayOfWeek, DS3231_ClockType_12_Hour,
+                 DS3231_PM>(),
+  ds3231::alarm2<DS3231_AlarmRate_PerMinute, 0, 0, 0>(),
+  ds3231::alarm2<DS3231_AlarmRate_M_Match, 15, 0, 0>(),
+  ds3231::alarm2<DS3231_AlarmRate_HM_Match, 15, 23, 0>(),
+  ds3231::alarm2<DS3231_AlarmRate_HM_Match, 15, 1, 0, DS3231_AlarmDayType_DayOfMonth, DS3231_ClockType_12_Hour>(),
+  ds3231::alarm2<DS3231_AlarmRate_DHM_Match, 15, 6, 1, DS3231_AlarmDayType_DayOfWeek>(),
+};
+
+static_assert(alarms[2].seconds == 30 && alarms[2].minutes == 15 && alarms[2].day == 0, "alarm 1 fields");
+static_assert(alarms[6].alarm_type == DS3231_AlarmType_Alarm2 && alarms[6].seconds == 0, "alarm 2 fields");
+
+constexpr DS3231_Calendar_t leap_day = ds3231::calendar<2024, 2, 29, 23, 59, 59, 4>();
+static_assert(leap_day.day_of_month == 29 && leap_day.year == 2024, "calendar fields");
+
+int main()
+{
+  int failures = 0;
+  for (const DS3231_AlarmSetting_t& alarm : alarms)
+  {
+    const DS3231_AlarmError_t err = ds3231_alarm_validate(&alarm);
+    if (err != DS3231_AlarmError_None)
+    {
+      std::printf("FAIL: alarm %d rate 0x%02x rejected with %d\n", alarm.alarm_type, alarm.alarm_rate, err);
+      failures++;
+    }
+  }
+
+  std::printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,333 @@
+/*
+ * Host test of the key-value store against a simulated DS3232. Every call is checked against a model of the keys, and
+ * the store is mounted again to check what reached the SRAM. Writes are cut short with ds3231_sim_fail_writes_after at
+ * every byte of an append and of a compaction, and the store must mount afterwards with either the old or the new
+ * value and every other key intact. Two threads then use the store at once.
+ */
+#include <ds3231_kv.h>
+#include <ds3231_sim.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define KEY_COUNT 6
+
+typedef struct
+{
+  uint8_t value[DS3231_KV_MAX_VALUE];
+  size_t len;  // 0 if the key is not set
+} Entry_t;
+
+static Entry_t model[KEY_COUNT];
+static int failures;
+
+#define CHECK(cond, ...)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(cond))                                                                                                       \
+    {                                                                                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                      \
+      printf(__VA_ARGS__);                                                                                             \
+      printf("\n");                                                                                                    \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+static DS3231_Cfg_t create_ds3232(void)
+{
+  DS3231_Cfg_t cfg = ds3231_create(0);
+  if (!cfg)
+    return NULL;
+
+  DS3231_Variant_t variant;
+  ds3231_sim_set_variant(cfg, DS3231_Variant_DS3232);
+  if (ds3231_detect_variant(cfg, &variant, 10) != ESP_OK || variant != DS3231_Variant_DS3232)
+  {
+    ds3231_delete(cfg);
+    return NULL;
+  }
+  memset(model, 0, sizeof(model));
+  return cfg;
+}
+
+static void model_set(uint8_t key, const void* value, size_t len)
+{
+  memcpy(model[key].value, value, len);
+  model[key].len = len;
+}
+
+// Every key reads back as in the model, from the cache and, if remount is set, from the SRAM.
+static void check_keys(DS3231_Cfg_t cfg, const char* name, bool remount)
+{
+  if (remount)
+  {
+    esp_err_t res = ds3231_kv_mount(cfg, 10);
+    CHECK(res == ESP_OK, "%s: mount returned %d", name, res);
+  }
+
+  for (uint8_t key = 0; key < KEY_COUNT; key++)
+  {
+    uint8_t value[DS3231_KV_MAX_VALUE];
+    size_t len = sizeof(value);
+    esp_err_t res = ds3231_kv_get(cfg, key, value, &len);
+    if (model[key].len == 0)
+      CHECK(res == ESP_ERR_NOT_FOUND, "%s: key %u deleted but get returned %d", name, key, res);
+    else
+      CHECK(res == ESP_OK && len == model[key].len && memcmp(value, model[key].value, len) == 0,
+            "%s: key %u returned %d with %zu bytes, expected %zu", name, key, res, len, model[key].len);
+  }
+}
+
+static void test_basic(void)
+{
+  DS3231_Cfg_t cfg = ds3231_create(0);
+  CHECK(cfg && ds3231_kv_mount(cfg, 10) == ESP_ERR_NOT_SUPPORTED, "mounted on a DS3231");
+  ds3231_delete(cfg);
+
+  cfg = create_ds3232();
+  CHECK(cfg != NULL, "no DS3232");
+  if (!cfg)
+    return;
+
+  uint8_t value[4] = { 1, 2, 3, 4 };
+  size_t len = sizeof(value);
+  CHECK(ds3231_kv_get(cfg, 0, value, &len) == ESP_ERR_INVALID_STATE, "get before mount");
+  CHECK(ds3231_kv_set(cfg, 0, value, 1, 10) == ESP_ERR_INVALID_STATE, "set before mount");
+
+  // SRAM without a header, as after the first power up, is an empty store
+  check_keys(cfg, "empty", true);
+  CHECK(ds3231_kv_set(cfg, 0, value, 4, 10) == ESP_OK, "set failed");
+  model_set(0, value, 4);
+  CHECK(ds3231_kv_set(cfg, 1, "boots", 5, 10) == ESP_OK, "set failed");
+  model_set(1, "boots", 5);
+  check_keys(cfg, "set", false);
+  check_keys(cfg, "set", true);
+
+  // a value too small is reported with the length needed
+  len = 2;
+  CHECK(ds3231_kv_get(cfg, 1, value, &len) == ESP_ERR_INVALID_SIZE && len == 5, "short buffer gave length %zu", len);
+
+  // an unchanged value is not written
+  ds3231_sim_fail_writes_after(cfg, 0);
+  CHECK(ds3231_kv_set(cfg, 1, "boots", 5, 10) == ESP_OK, "unchanged value was written");
+  ds3231_sim_fail_writes_after(cfg, SIZE_MAX);
+
+  CHECK(ds3231_kv_delete(cfg, 0, 10) == ESP_OK, "delete failed");
+  model[0].len = 0;
+  CHECK(ds3231_kv_delete(cfg, 0, 10) == ESP_ERR_NOT_FOUND, "deleted twice");
+  CHECK(ds3231_kv_delete(cfg, 2, 10) == ESP_ERR_NOT_FOUND, "deleted a key never set");
+  check_keys(cfg, "delete", true);
+
+  CHECK(ds3231_kv_set(cfg, DS3231_KV_END, value, 1, 10) == ESP_ERR_INVALID_ARG, "set the end marker key");
+  CHECK(ds3231_kv_set(cfg, 2, value, 0, 10) == ESP_ERR_INVALID_ARG, "set an empty value");
+  CHECK(ds3231_kv_set(cfg, 2, value, DS3231_KV_MAX_VALUE + 1, 10) == ESP_ERR_INVALID_ARG, "set too long a value");
+
+  // the largest value does not fit with another key live, and does once that is gone
+  static const uint8_t large[DS3231_KV_MAX_VALUE] = { 0x5A };
+  CHECK(ds3231_kv_set(cfg, 2, large, sizeof(large), 10) == ESP_ERR_NO_MEM, "largest value fitted with another key");
+  check_keys(cfg, "no room", true);
+  CHECK(ds3231_kv_format(cfg, 10) == ESP_OK, "format failed");
+  model[1].len = 0;
+  check_keys(cfg, "format", true);
+  CHECK(ds3231_kv_set(cfg, 2, large, sizeof(large), 10) == ESP_OK, "largest value did not fit alone");
+  model_set(2, large, sizeof(large));
+  check_keys(cfg, "largest value", true);
+  ds3231_delete(cfg);
+}
+
+// The bank headers change only when the store switches bank.
+static bool switched(const uint8_t* before, DS3231_Cfg_t cfg)
+{
+  const uint8_t* sram = &ds3231_sim_regs(cfg)[DS3232_SRAM_REG];
+  return memcmp(before, sram, DS3231_KV_HEADER_LEN) != 0 ||
+         memcmp(&before[DS3231_KV_BANK_LEN], &sram[DS3231_KV_BANK_LEN], DS3231_KV_HEADER_LEN) != 0;
+}
+
+static void test_compaction(void)
+{
+  DS3231_Cfg_t cfg = create_ds3232();
+  if (!cfg)
+    return;
+  CHECK(ds3231_kv_mount(cfg, 10) == ESP_OK, "mount failed");
+
+  // counters updated at different rates, with keys deleted and set again, through many bank switches
+  int switches = 0;
+  uint8_t before[DS3232_SRAM_LEN];
+  for (uint32_t i = 0; i < 500; i++)
+  {
+    const uint8_t key = i % 7 < 4 ? 0 : i % KEY_COUNT;
+    memcpy(before, &ds3231_sim_regs(cfg)[DS3232_SRAM_REG], sizeof(before));
+    esp_err_t res;
+    if (i % 23 == 0 && model[key].len)
+    {
+      res = ds3231_kv_delete(cfg, key, 10);
+      model[key].len = 0;
+    }
+    else
+    {
+      uint8_t value[8];
+      const size_t len = 1 + (i * 5 + key) % sizeof(value);
+      memset(value, (int)(i & 0xFF), len);
+      res = ds3231_kv_set(cfg, key, value, len, 10);
+      model_set(key, value, len);
+    }
+    CHECK(res == ESP_OK, "update %u returned %d", i, res);
+    switches += switched(before, cfg);
+    check_keys(cfg, "compaction", i % 10 == 0);
+  }
+  CHECK(switches >= 20, "only %d bank switches in 500 updates", switches);
+  check_keys(cfg, "compaction", true);
+  ds3231_delete(cfg);
+}
+
+// Fill the store with three keys and update key 0 until the next update, saved in snapshot, switches bank or, if
+// compaction is not set, is the first append after a switch to a bank whose last use started with the same live
+// records, so the old records past them line up with the new ones.
+static DS3231_Cfg_t prepare(uint8_t* snapshot, bool compaction)
+{
+  DS3231_Cfg_t cfg = create_ds3232();
+  if (!cfg || ds3231_kv_mount(cfg, 10) != ESP_OK)
+    return cfg;
+  ds3231_kv_set(cfg, 0, "zero", 4, 10);
+  model_set(0, "zero", 4);
+  ds3231_kv_set(cfg, 1, "one", 3, 10);
+  model_set(1, "one", 3);
+  ds3231_kv_set(cfg, 2, "two", 3, 10);
+  model_set(2, "two", 3);
+
+  int switches = 0;
+  bool last_switched = false;
+  for (uint8_t i = 0;; i++)
+  {
+    uint8_t* regs = ds3231_sim_regs(cfg);
+    uint8_t before[DS3232_REG_COUNT];
+    memcpy(before, regs, sizeof(before));
+    const uint8_t value[2] = { i, 0xAA };
+    ds3231_kv_set(cfg, 0, value, sizeof(value), 10);
+    const bool now_switched = switched(&before[DS3232_SRAM_REG], cfg);
+    if (compaction ? now_switched : switches >= 4 && last_switched && !now_switched)
+    {
+      // undo the update, which the caller makes again with writes failing
+      memcpy(snapshot, before, sizeof(before));
+      memcpy(regs, before, sizeof(before));
+      ds3231_kv_mount(cfg, 10);
+      return cfg;
+    }
+    model_set(0, value, sizeof(value));
+    switches += now_switched;
+    last_switched = now_switched;
+  }
+}
+
+// Cut the next update of key 0 short after each possible number of bytes written; burst is its length in bytes and
+// done the number after which the new value is kept.
+static void test_torn(const char* name, bool compaction, size_t burst, size_t done)
+{
+  uint8_t snapshot[DS3232_REG_COUNT];
+  DS3231_Cfg_t cfg = prepare(snapshot, compaction);
+  if (!cfg)
+  {
+    CHECK(false, "%s: no DS3232", name);
+    return;
+  }
+
+  const Entry_t old = model[0];
+  // the same length as the updates made by prepare, so it appends or switches bank as they do
+  static const uint8_t update[] = { 'n', 'w' };
+  for (size_t written = 0; written <= burst; written++)
+  {
+    memcpy(ds3231_sim_regs(cfg), snapshot, sizeof(snapshot));
+    model[0] = old;
+    CHECK(ds3231_kv_mount(cfg, 10) == ESP_OK, "%s: mount failed", name);
+
+    ds3231_sim_fail_writes_after(cfg, written);
+    esp_err_t res = ds3231_kv_set(cfg, 0, update, sizeof(update), 10);
+    ds3231_sim_fail_writes_after(cfg, SIZE_MAX);
+    CHECK(res == (written < burst ? ESP_FAIL : ESP_OK), "%s: cut after %zu bytes returned %d", name, written, res);
+
+    // the cache was dropped with the failed write, so the store must be mounted again
+    if (res != ESP_OK)
+    {
+      size_t len = 0;
+      CHECK(ds3231_kv_get(cfg, 0, NULL, &len) == ESP_ERR_INVALID_STATE, "%s: cache kept after a failed write", name);
+    }
+    if (written >= done)
+      model_set(0, update, sizeof(update));
+
+    char step[64];
+    snprintf(step, sizeof(step), "%s cut after %zu of %zu bytes", name, written, burst);
+    check_keys(cfg, step, true);
+
+    // the recovered store takes further updates
+    CHECK(ds3231_kv_set(cfg, 3, "after", 5, 10) == ESP_OK, "%s: set after recovery failed", step);
+    model_set(3, "after", 5);
+    check_keys(cfg, step, true);
+    model[3].len = 0;
+  }
+  ds3231_delete(cfg);
+}
+
+typedef struct
+{
+  DS3231_Cfg_t cfg;
+  int errors;
+} Worker_t;
+
+static void* writer_thread(void* arg)
+{
+  Worker_t* worker = arg;
+  for (uint32_t i = 0; i < 2000; i++)
+  {
+    if (ds3231_kv_set(worker->cfg, 0, &i, sizeof(i), 1000) != ESP_OK)
+      worker->errors++;
+  }
+  return NULL;
+}
+
+static void test_threads(void)
+{
+  DS3231_Cfg_t cfg = create_ds3232();
+  if (!cfg || ds3231_kv_mount(cfg, 10) != ESP_OK)
+  {
+    CHECK(false, "no DS3232");
+    ds3231_delete(cfg);
+    return;
+  }
+  ds3231_kv_set(cfg, 1, "fixed", 5, 10);
+
+  // reads of one key while another is updated, through bank switches which rewrite the whole cache
+  Worker_t worker = { .cfg = cfg };
+  pthread_t thread;
+  pthread_create(&thread, NULL, writer_thread, &worker);
+  int bad = 0;
+  for (int i = 0; i < 20000; i++)
+  {
+    char value[8];
+    size_t len = sizeof(value);
+    if (ds3231_kv_get(cfg, 1, value, &len) != ESP_OK || len != 5 || memcmp(value, "fixed", 5) != 0)
+      bad++;
+  }
+  pthread_join(thread, NULL);
+
+  uint32_t last = 0;
+  size_t len = sizeof(last);
+  CHECK(bad == 0, "%d reads differed while another key was updated", bad);
+  CHECK(worker.errors == 0, "%d updates failed while another key was read", worker.errors);
+  CHECK(ds3231_kv_get(cfg, 0, &last, &len) == ESP_OK && last == 1999, "last update reads back as %u", last);
+  ds3231_delete(cfg);
+}
+
+int main(void)
+{
+  test_basic();
+  test_compaction();
+  // an append writes the record and the end marker in one burst; the record is complete before the end marker
+  test_torn("append", false, 2 + DS3231_KV_OVERHEAD + 1, 2 + DS3231_KV_OVERHEAD);
+  // a compaction writes the new bank, then its header; only the whole header switches bank
+  test_torn("compaction", true, DS3231_KV_BANK_LEN, DS3231_KV_BANK_LEN);
+  test_threads();
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,311 @@
+/*
+ * Host test of the Linux i2c-dev backend against a stand-in for /dev/i2c-N. The test defines open, close and ioctl, so
+ * the backend linked into it talks to a fake adapter instead of the kernel. The fake adapter holds a 256 byte register
+ * file at 0x68, which detects as a DS3232, and either supports I2C_RDWR or only SMBus I2C block transfers. Every
+ * transfer is checked against the adapter's rules, and the ioctls made are counted per request.
+ */
+#include <ds3231.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#define FAKE_ADAPTER 7
+#define FAKE_FD      1000
+
+typedef struct
+{
+  unsigned long funcs;   // I2C_FUNCS reported by the adapter
+  int error;             // errno returned by transfers, 0 to complete them
+  bool open;
+  int slave;             // address set with I2C_SLAVE, -1 if none
+  uint8_t regs[256];
+  uint8_t ptr;           // register pointer, which wraps at the end of the register file as on the chip
+  int rdwr;              // I2C_RDWR ioctls made
+  int smbus;             // I2C_SMBUS ioctls made
+  int other;             // any other transfer ioctl, e.g. I2C_TIMEOUT
+  int bad;               // transfers which broke the adapter's rules
+} FakeAdapter_t;
+
+static FakeAdapter_t fake;
+static int failures;
+
+#define CHECK(cond, ...)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(cond))                                                                                                       \
+    {                                                                                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                      \
+      printf(__VA_ARGS__);                                                                                             \
+      printf("\n");                                                                                                    \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+int open(const char* path, int flags, ...)
+{
+  char fake_path[32];
+  snprintf(fake_path, sizeof(fake_path), "/dev/i2c-%d", FAKE_ADAPTER);
+  if (strcmp(path, fake_path) == 0)
+  {
+    if (fake.open)
+    {
+      errno = EBUSY;
+      return -1;
+    }
+    fake.open = true;
+    return FAKE_FD;
+  }
+  if (strncmp(path, "/dev/i2c-", 9) == 0)
+  {
+    errno = ENOENT;
+    return -1;
+  }
+
+  va_list args;
+  va_start(args, flags);
+  mode_t mode = va_arg(args, mode_t);
+  va_end(args);
+  return (int)syscall(SYS_openat, AT_FDCWD, path, flags, mode);
+}
+
+int close(int fd)
+{
+  if (fd == FAKE_FD)
+  {
+    fake.open = false;
+    return 0;
+  }
+  return (int)syscall(SYS_close, fd);
+}
+
+static int fake_transfer_error(void)
+{
+  if (!fake.error)
+    return 0;
+  errno = fake.error;
+  return -1;
+}
+
+static void fake_write(const uint8_t* data, size_t len)
+{
+  fake.ptr = data[0];
+  for (size_t i = 1; i < len; i++)
+    fake.regs[fake.ptr++] = data[i];
+}
+
+static void fake_read(uint8_t* data, size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+    data[i] = fake.regs[fake.ptr++];
+}
+
+static int fake_rdwr(struct i2c_rdwr_ioctl_data* rdwr)
+{
+  fake.rdwr++;
+  if (!(fake.funcs & I2C_FUNC_I2C))
+  {
+    fake.bad++;
+    errno = EOPNOTSUPP;
+    return -1;
+  }
+  if (fake_transfer_error())
+    return -1;
+
+  // a register write, or a register address write and read joined by a repeated start
+  struct i2c_msg* msgs = rdwr->msgs;
+  for (uint32_t i = 0; i < rdwr->nmsgs; i++)
+  {
+    if (msgs[i].addr != 0x68 || msgs[i].len == 0)
+    {
+      fake.bad++;
+      errno = ENXIO;
+      return -1;
+    }
+  }
+  if (rdwr->nmsgs == 1 && !(msgs[0].flags & I2C_M_RD))
+  {
+    fake_write(msgs[0].buf, msgs[0].len);
+  }
+  else if (rdwr->nmsgs == 2 && !(msgs[0].flags & I2C_M_RD) && msgs[0].len == 1 && (msgs[1].flags & I2C_M_RD))
+  {
+    fake_write(msgs[0].buf, 1);
+    fake_read(msgs[1].buf, msgs[1].len);
+  }
+  else
+  {
+    fake.bad++;
+    errno = EINVAL;
+    return -1;
+  }
+  return (int)rdwr->nmsgs;
+}
+
+static int fake_smbus(struct i2c_smbus_ioctl_data* args)
+{
+  fake.smbus++;
+  const uint8_t len = args->data->block[0];
+  if (fake.slave != 0x68 || args->size != I2C_SMBUS_I2C_BLOCK_DATA || len == 0 || len > I2C_SMBUS_BLOCK_MAX)
+  {
+    fake.bad++;
+    errno = EINVAL;
+    return -1;
+  }
+  if (fake_transfer_error())
+    return -1;
+
+  fake.ptr = args->command;
+  if (args->read_write == I2C_SMBUS_WRITE)
+  {
+    for (size_t i = 1; i <= len; i++)
+      fake.regs[fake.ptr++] = args->data->block[i];
+  }
+  else
+  {
+    fake_read(&args->data->block[1], len);
+  }
+  return 0;
+}
+
+int ioctl(int fd, unsigned long request, ...)
+{
+  va_list args;
+  va_start(args, request);
+  void* arg = va_arg(args, void*);
+  va_end(args);
+
+  if (fd != FAKE_FD || !fake.open)
+  {
+    errno = EBADF;
+    return -1;
+  }
+
+  switch (request)
+  {
+    case I2C_FUNCS:
+      *(unsigned long*)arg = fake.funcs;
+      return 0;
+    case I2C_SLAVE:
+      fake.slave = (int)(uintptr_t)arg;
+      return 0;
+    case I2C_RDWR:
+      return fake_rdwr(arg);
+    case I2C_SMBUS:
+      return fake_smbus(arg);
+    default:
+      fake.other++;
+      errno = ENOTTY;
+      return -1;
+  }
+}
+
+static void fake_reset(unsigned long funcs)
+{
+  memset(&fake, 0, sizeof(fake));
+  fake.funcs = funcs;
+  fake.slave = -1;
+  for (size_t i = DS3232_SRAM_REG; i < sizeof(fake.regs); i++)
+    fake.regs[i] = (uint8_t)(i * 7);
+  fake.regs[DS3231_CAL_REG + 4] = 0x01;
+  fake.regs[DS3231_CAL_REG + 5] = 0x01;
+}
+
+static void test_adapter(const char* name, unsigned long funcs, int sram_transfers)
+{
+  fake_reset(funcs);
+  DS3231_Cfg_t cfg = ds3231_create(FAKE_ADAPTER);
+  CHECK(cfg != NULL, "%s: create failed", name);
+  if (!cfg)
+    return;
+  CHECK(fake.open, "%s: adapter not open", name);
+
+  DS3231_Calendar_t set = {
+    .seconds = 56,
+    .minutes = 34,
+    .hour = 12,
+    .day_of_week = 3,
+    .day_of_month = 28,
+    .month = 2,
+    .year = 2024,
+    .clock_type = DS3231_ClockType_24_Hour,
+  };
+  DS3231_Calendar_t get;
+  esp_err_t res = ds3231_set_calendar(cfg, &set, 10);
+  if (res == ESP_OK)
+    res = ds3231_get_calendar(cfg, &get, 10);
+  CHECK(res == ESP_OK, "%s: calendar returned %d", name, res);
+  CHECK(res != ESP_OK || (get.seconds == 56 && get.minutes == 34 && get.hour == 12 && get.day_of_month == 28 &&
+                          get.month == 2 && get.year == 2024),
+        "%s: calendar read back differs", name);
+  CHECK(fake.regs[DS3231_CAL_REG] == 0x56 && fake.regs[DS3231_CAL_REG + 6] == 0x24, "%s: registers are 0x%02x..0x%02x",
+        name, fake.regs[DS3231_CAL_REG], fake.regs[DS3231_CAL_REG + 6]);
+
+  DS3231_Variant_t variant;
+  res = ds3231_detect_variant(cfg, &variant, 10);
+  CHECK(res == ESP_OK && variant == DS3231_Variant_DS3232, "%s: detected %d, returned %d", name, variant, res);
+
+  // the whole SRAM in one burst: one I2C_RDWR, or split into SMBus blocks of 32
+  uint8_t sram[DS3232_SRAM_LEN];
+  const int rdwr = fake.rdwr, smbus = fake.smbus;
+  res = ds3231_read_raw(cfg, DS3232_SRAM_REG, sram, sizeof(sram), 10);
+  CHECK(res == ESP_OK, "%s: SRAM read returned %d", name, res);
+  CHECK((fake.rdwr - rdwr) + (fake.smbus - smbus) == sram_transfers, "%s: SRAM read took %d transfers", name,
+        (fake.rdwr - rdwr) + (fake.smbus - smbus));
+  bool same = true;
+  for (size_t i = 0; i < sizeof(sram); i++)
+    same &= sram[i] == (uint8_t)((DS3232_SRAM_REG + i) * 7);
+  CHECK(same, "%s: SRAM read differs", name);
+
+  for (size_t i = 0; i < sizeof(sram); i++)
+    sram[i] = (uint8_t)~i;
+  res = ds3231_write_raw(cfg, DS3232_SRAM_REG, sram, sizeof(sram), 10);
+  CHECK(res == ESP_OK && memcmp(&fake.regs[DS3232_SRAM_REG], sram, sizeof(sram)) == 0, "%s: SRAM write returned %d",
+        name, res);
+
+  // errno from the adapter, e.g. no acknowledge from the DS3231 or an adapter timeout
+  fake.error = EREMOTEIO;
+  res = ds3231_read_raw(cfg, DS3231_CAL_REG, sram, DS3231_CAL_LEN, 10);
+  CHECK(res == ESP_FAIL, "%s: NACK returned %d", name, res);
+  fake.error = ETIMEDOUT;
+  res = ds3231_write_raw(cfg, DS3231_CAL_REG, sram, 1, 10);
+  CHECK(res == ESP_ERR_TIMEOUT, "%s: adapter timeout returned %d", name, res);
+  fake.error = 0;
+
+  ds3231_delete(cfg);
+  CHECK(!fake.open, "%s: adapter left open", name);
+  CHECK(fake.bad == 0, "%s: %d transfers broke the adapter's rules", name, fake.bad);
+  CHECK(fake.other == 0, "%s: %d other ioctls, e.g. I2C_TIMEOUT", name, fake.other);
+}
+
+static void test_open_failures(void)
+{
+  // no adapter
+  fake_reset(I2C_FUNC_I2C);
+  CHECK(ds3231_create(FAKE_ADAPTER + 1) == NULL, "create succeeded without an adapter");
+
+  // an adapter with neither I2C_RDWR nor SMBus I2C block transfers
+  fake_reset(I2C_FUNC_SMBUS_BYTE_DATA);
+  CHECK(ds3231_create(FAKE_ADAPTER) == NULL, "create succeeded on an adapter without block transfers");
+  CHECK(!fake.open, "adapter left open after an unsupported adapter");
+
+  // nothing acknowledges at 0x68
+  fake_reset(I2C_FUNC_I2C);
+  fake.error = ENXIO;
+  CHECK(ds3231_create(FAKE_ADAPTER) == NULL, "create succeeded without a DS3231");
+  CHECK(!fake.open, "adapter left open without a DS3231");
+}
+
+int main(void)
+{
+  test_adapter("I2C_RDWR", I2C_FUNC_I2C | I2C_FUNC_SMBUS_I2C_BLOCK, 1);
+  test_adapter("SMBus", I2C_FUNC_SMBUS_I2C_BLOCK, (DS3232_SRAM_LEN + I2C_SMBUS_BLOCK_MAX - 1) / I2C_SMBUS_BLOCK_MAX);
+  test_open_failures();
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
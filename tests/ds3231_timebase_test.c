@@ -0,0 +1,213 @@
+/*
+ * Host test of the square wave timebase against the simulated chip. A thread stands in for INT/SQW, counting edges at
+ * 1024Hz in real time and advancing the simulated seconds register every 1024 edges, and can drop edges to check that
+ * ds3231_timebase_resync reports them. The sleep step is checked with edges and a local clock running fast, as the
+ * ESP32's RC oscillator may.
+ */
+#include <ds3231_regs.h>
+#include <ds3231_sim.h>
+#include <ds3231_time.h>
+#include <ds3231_timebase.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define SQW_HZ 1024
+
+static int failures;
+
+#define CHECK(cond, ...)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(cond))                                                                                                       \
+    {                                                                                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                      \
+      printf(__VA_ARGS__);                                                                                             \
+      printf("\n");                                                                                                    \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+typedef struct
+{
+  DS3231_Timebase_t* tb;
+  uint8_t* regs;
+  int drop;           // edges still to be dropped
+  uint32_t max_burst; // most edges emitted at once, after the thread was late to wake
+  bool stop;
+} EdgeSource_t;
+
+static int64_t local_us(void)
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void sleep_ms(long ms)
+{
+  struct timespec delay = { .tv_sec = ms / 1000, .tv_nsec = (ms % 1000) * 1000000 };
+  nanosleep(&delay, NULL);
+}
+
+// the calendar starts at second 0 and the test takes well under a minute, so only the seconds register changes
+static void* edge_source(void* arg)
+{
+  EdgeSource_t* source = arg;
+  const int64_t start = local_us();
+  uint64_t emitted = 0;
+  while (!__atomic_load_n(&source->stop, __ATOMIC_ACQUIRE))
+  {
+    const uint64_t due = (uint64_t)(local_us() - start) * SQW_HZ / 1000000;
+    if (due - emitted > __atomic_load_n(&source->max_burst, __ATOMIC_ACQUIRE))
+      __atomic_store_n(&source->max_burst, (uint32_t)(due - emitted), __ATOMIC_RELEASE);
+    for (; emitted < due; emitted++)
+    {
+      if (__atomic_load_n(&source->drop, __ATOMIC_ACQUIRE) > 0)
+        __atomic_fetch_sub(&source->drop, 1, __ATOMIC_ACQ_REL);
+      else
+        ds3231_timebase_edge_at_from_isr(source->tb, local_us());
+
+      if ((emitted + 1) % SQW_HZ == 0)
+      {
+        const uint8_t seconds = ds3231_bcd_decode(__atomic_load_n(&source->regs[DS3231_CAL_REG], __ATOMIC_ACQUIRE));
+        __atomic_store_n(&source->regs[DS3231_CAL_REG], ds3231_bcd_encode(seconds + 1), __ATOMIC_RELEASE);
+      }
+    }
+    sleep_ms(1);
+  }
+  return NULL;
+}
+
+static void test_init(DS3231_Cfg_t cfg)
+{
+  DS3231_Timebase_t tb;
+  memset(&tb, 0xA5, sizeof(tb));
+  esp_err_t res = ds3231_timebase_init(&tb, cfg, DS3231_SquareWave_1024Hz, 10);
+  CHECK(res == ESP_OK, "init returned %d", res);
+  CHECK(tb.edges == 0 && tb.edge_stamp == 0 && !tb.synced, "init did not reset the timebase");
+  CHECK(tb.freq_hz == SQW_HZ, "freq_hz is %u", tb.freq_hz);
+
+  const uint8_t ctrl = ds3231_sim_regs(cfg)[DS3231_CTRL_REG];
+  CHECK((ctrl & 0x1C) == (DS3231_SquareWave_1024Hz << 3), "control register is 0x%02x", ctrl);
+
+  res = ds3231_timebase_init(&tb, cfg, (DS3231_SquareWave_t)4, 10);
+  CHECK(res == ESP_ERR_INVALID_ARG, "init with an invalid rate returned %d", res);
+}
+
+static void test_resync(DS3231_Cfg_t cfg)
+{
+  static DS3231_Timebase_t tb;
+  esp_err_t res = ds3231_timebase_init(&tb, cfg, DS3231_SquareWave_1024Hz, 10);
+  CHECK(res == ESP_OK, "init returned %d", res);
+
+  EdgeSource_t source = { .tb = &tb, .regs = ds3231_sim_regs(cfg) };
+  pthread_t thread;
+  pthread_create(&thread, NULL, edge_source, &source);
+
+  // a burst of edges may pass the second boundary between counting the edges and reading the calendar, which an ISR
+  // would not; allow for the largest burst on top of the polling uncertainty
+#define TOLERANCE ((int32_t)(tb.edge_tolerance + __atomic_load_n(&source.max_burst, __ATOMIC_ACQUIRE)))
+
+  res = ds3231_timebase_resync(&tb, cfg, 10);
+  CHECK(res == ESP_OK && tb.synced, "first resync returned %d", res);
+
+  sleep_ms(300);
+  res = ds3231_timebase_resync(&tb, cfg, 10);
+  CHECK(res == ESP_OK, "second resync returned %d", res);
+  CHECK(tb.edge_error <= TOLERANCE && tb.edge_error >= -TOLERANCE, "edge_error %d with no edges lost, tolerance %d",
+        tb.edge_error, TOLERANCE);
+
+  // the calendar derived from the edges matches the registers to within a second
+  const int64_t epoch = ds3231_raw_calendar_to_epoch(ds3231_sim_regs(cfg));
+  const int64_t now = ds3231_timebase_now_us(&tb) / 1000000;
+  CHECK(now - epoch <= 1 && epoch - now <= 1, "now_us gives %lld, calendar %lld", (long long)now, (long long)epoch);
+
+  // ticks of a 1kHz software timer over 200ms
+  uint64_t mark = ds3231_timebase_mark(&tb, 1000);
+  sleep_ms(200);
+  const uint32_t ticks = ds3231_timebase_elapsed_ticks(&tb, &mark, 1000);
+  CHECK(ticks >= 150 && ticks <= 250, "%u ticks elapsed in 200ms", ticks);
+
+  // position interpolates between edges with the recorded edge times
+  const int64_t local_start = local_us();
+  const int64_t position_start = ds3231_timebase_position_us(&tb, local_start);
+  sleep_ms(100);
+  const int64_t local_end = local_us();
+  const int64_t moved = ds3231_timebase_position_us(&tb, local_end) - position_start;
+  CHECK(moved > 50000 && moved < 150000, "position moved %lld us in %lld us", (long long)moved,
+        (long long)(local_end - local_start));
+
+  // lost edges are reported beyond the polling uncertainty, and the timeline moves to the count
+  __atomic_store_n(&source.drop, 300, __ATOMIC_RELEASE);
+  sleep_ms(500);
+  res = ds3231_timebase_resync(&tb, cfg, 10);
+  CHECK(res == ESP_OK, "resync after lost edges returned %d", res);
+  CHECK(tb.edge_error + 300 <= TOLERANCE && tb.edge_error + 300 >= -TOLERANCE,
+        "edge_error %d after 300 edges lost, tolerance %d", tb.edge_error, TOLERANCE);
+
+  res = ds3231_timebase_resync(&tb, cfg, 10);
+  CHECK(res == ESP_OK, "resync after recovery returned %d", res);
+  CHECK(tb.edge_error <= TOLERANCE && tb.edge_error >= -TOLERANCE,
+        "edge_error %d after the timeline moved, tolerance %d", tb.edge_error, TOLERANCE);
+#undef TOLERANCE
+
+  __atomic_store_n(&source.stop, true, __ATOMIC_RELEASE);
+  pthread_join(thread, NULL);
+
+  // a stopped oscillator is reported rather than waited on forever
+  res = ds3231_timebase_resync(&tb, cfg, 10);
+  CHECK(res == ESP_ERR_TIMEOUT, "resync with the seconds register stopped returned %d", res);
+}
+
+static void test_sleep_step(void)
+{
+  // a 1Hz square wave while the local clock runs 3% fast; light sleep from 10.3s to 25.6s
+  DS3231_Timebase_t tb = { .freq_hz = 1 };
+  const int64_t fast_ppm = 30000;
+  int64_t start = 0;
+  for (int64_t second = 1; second <= 25; second++)
+  {
+    ds3231_timebase_edge_at_from_isr(&tb, second * (1000000 + fast_ppm));
+    if (second == 10)
+      start = ds3231_timebase_position_us(&tb, 10300000 * (1000000 + fast_ppm) / 1000000);
+  }
+  const int64_t end = ds3231_timebase_position_us(&tb, 25600000 * (1000000 + fast_ppm) / 1000000);
+  const uint32_t ticks = ds3231_timebase_slept_ticks(&tb, start, end, 1000, 60000);
+  CHECK(ticks >= 15300 - 30 && ticks <= 15300 + 30, "stepped %u ticks for 15300ms asleep", ticks);
+
+  // fractions of a tick are carried, so many short sleeps add up
+  DS3231_Timebase_t carry = { .freq_hz = 1 };
+  uint32_t total = 0;
+  for (int i = 0; i < 20; i++)
+    total += ds3231_timebase_slept_ticks(&carry, i * 3500, (i + 1) * 3500, 100, 1000);
+  CHECK(total == 7, "stepped %u ticks for 20 sleeps of 3.5ms at 100Hz", total);
+
+  // the step never passes the expected idle time
+  const uint32_t capped = ds3231_timebase_slept_ticks(&carry, 0, 1000000, 100, 10);
+  CHECK(capped == 10 && carry.sleep_carry == 0, "stepped %u ticks with a limit of 10", capped);
+
+  // an edge counted without a time falls back to whole edges
+  ds3231_timebase_edge_from_isr(&tb);
+  const int64_t whole = ds3231_timebase_position_us(&tb, 27000000);
+  CHECK(whole == 26000000, "position %lld after an edge without a time", (long long)whole);
+}
+
+int main(void)
+{
+  DS3231_Cfg_t cfg = ds3231_create(0);
+  if (!cfg)
+  {
+    printf("out of memory\n");
+    return 1;
+  }
+
+  test_init(cfg);
+  test_resync(cfg);
+  test_sleep_step();
+  ds3231_delete(cfg);
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,285 @@
+/*
+ * Host test of the timestamp log. Random timestamps, from steps of a second to jumps across the whole range, are
+ * written and read back at several block sizes. The erased tail of each block and whole erased blocks must read as the
+ * end of the data rather than corruption, and other bytes there as a corrupt block. A block stored early by
+ * ds3231_tslog_sync is continued after a simulated reset, including from a copy cut short by a lost write.
+ */
+#include <ds3231_tslog.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STORE_SIZE  32768 // room for ENTRY_COUNT entries at the smallest block size
+#define ENTRY_COUNT 2000
+#define LIMIT       ((int64_t)1 << 62)
+
+typedef struct
+{
+  uint8_t data[STORE_SIZE];
+  size_t next;   // offset of the block being filled
+  size_t size;   // bytes written, up to the end of the last block stored
+  int complete;  // complete blocks stored
+  int partial;   // blocks stored early by ds3231_tslog_sync
+} Store_t;
+
+static Store_t store;
+static int failures;
+
+#define CHECK(cond, ...)                                                                                               \
+  do                                                                                                                   \
+  {                                                                                                                    \
+    if (!(cond))                                                                                                       \
+    {                                                                                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                                                                      \
+      printf(__VA_ARGS__);                                                                                             \
+      printf("\n");                                                                                                    \
+      failures++;                                                                                                      \
+    }                                                                                                                  \
+  } while (0)
+
+// xorshift32, seeded so a failure can be reproduced
+static uint32_t random_state = 0x3231u;
+
+static uint32_t random_u32(void)
+{
+  random_state ^= random_state << 13;
+  random_state ^= random_state >> 17;
+  random_state ^= random_state << 5;
+  return random_state;
+}
+
+static int store_flush(void* arg, const uint8_t* block, size_t block_size, bool complete)
+{
+  Store_t* s = arg;
+  if (s->next + block_size > sizeof(s->data))
+    return -1;
+
+  memcpy(&s->data[s->next], block, block_size);
+  if (s->next + block_size > s->size)
+    s->size = s->next + block_size;
+  if (complete)
+  {
+    s->next += block_size;
+    s->complete++;
+  }
+  else
+  {
+    s->partial++;
+  }
+  return 0;
+}
+
+static void store_reset(void)
+{
+  memset(&store, 0, sizeof(store));
+  memset(store.data, 0xFF, sizeof(store.data));
+}
+
+// Mostly small steps as when logging events, with some large jumps, backwards steps and the ends of the range.
+static int64_t random_step(int64_t last)
+{
+  int64_t next;
+  switch (random_u32() % 8)
+  {
+    case 0:
+      next = last - (int64_t)(random_u32() % 86400);
+      break;
+    case 1:
+      next = last + ((int64_t)random_u32() << 20);
+      break;
+    case 2:
+      next = (int64_t)(((uint64_t)random_u32() << 32 | random_u32()) % (2 * (uint64_t)LIMIT - 1)) - (LIMIT - 1);
+      break;
+    case 3:
+      next = random_u32() % 2 ? LIMIT - 1 : -(LIMIT - 1);
+      break;
+    default:
+      next = last + random_u32() % 600;
+      break;
+  }
+  return next > -LIMIT && next < LIMIT ? next : 1700000000;
+}
+
+static int check_read(const char* name, const uint8_t* data, size_t size, size_t block_size, const int64_t* expected,
+                      size_t count, uint32_t errors)
+{
+  DS3231_TsLogReader_t reader;
+  ds3231_tslog_reader_init(&reader, data, size, block_size);
+  size_t n = 0;
+  int64_t epoch;
+  while (ds3231_tslog_next(&reader, &epoch))
+  {
+    if (n < count && epoch != expected[n])
+    {
+      CHECK(false, "%s: entry %zu is %lld, expected %lld", name, n, (long long)epoch, (long long)expected[n]);
+      return 1;
+    }
+    n++;
+  }
+  CHECK(n == count, "%s: read %zu entries, expected %zu", name, n, count);
+  CHECK(reader.errors == errors, "%s: %u corrupt blocks, expected %u", name, reader.errors, errors);
+  return n != count || reader.errors != errors;
+}
+
+static void test_round_trip(size_t block_size)
+{
+  static int64_t entries[ENTRY_COUNT];
+  uint8_t block[256];
+  char name[32];
+  snprintf(name, sizeof(name), "round trip, block %zu", block_size);
+
+  store_reset();
+  DS3231_TsLogWriter_t writer;
+  ds3231_tslog_writer_init(&writer, block, block_size, store_flush, &store);
+
+  int64_t last = 1700000000;
+  const size_t count = ENTRY_COUNT;
+  for (size_t i = 0; i < count; i++)
+  {
+    last = random_step(last);
+    const int res = ds3231_tslog_append(&writer, last);
+    CHECK(res == 0, "%s: append %lld returned %d", name, (long long)last, res);
+    entries[i] = last;
+  }
+  CHECK(ds3231_tslog_sync(&writer) == 0, "%s: sync failed", name);
+  check_read(name, store.data, store.size, block_size, entries, count, 0);
+
+  // flash never written reads as the end of the log, not corruption
+  check_read(name, store.data, sizeof(store.data) - sizeof(store.data) % block_size, block_size, entries, count, 0);
+
+  // every block but the last is complete, each with an erased tail shorter than the largest entry
+  for (size_t offset = 0; offset + block_size < store.size; offset += block_size)
+  {
+    size_t tail = 0;
+    while (tail < block_size && store.data[offset + block_size - 1 - tail] == 0xFF)
+      tail++;
+    CHECK(tail < DS3231_TSLOG_MAX_ENTRY, "%s: block at %zu has an erased tail of %zu bytes", name, offset, tail);
+  }
+}
+
+static void test_range(void)
+{
+  uint8_t block[32];
+  store_reset();
+  DS3231_TsLogWriter_t writer;
+  ds3231_tslog_writer_init(&writer, block, sizeof(block), store_flush, &store);
+
+  CHECK(ds3231_tslog_append(&writer, LIMIT) == DS3231_TSLOG_ERR_RANGE, "2^62 accepted");
+  CHECK(ds3231_tslog_append(&writer, -LIMIT) == DS3231_TSLOG_ERR_RANGE, "-2^62 accepted");
+  CHECK(writer.used == 0, "a rejected timestamp was written");
+
+  // the largest jump, from one end of the range to the other, needs an absolute entry
+  const int64_t ends[] = { -(LIMIT - 1), LIMIT - 1, -(LIMIT - 1) };
+  for (size_t i = 0; i < 3; i++)
+    CHECK(ds3231_tslog_append(&writer, ends[i]) == 0, "append %lld failed", (long long)ends[i]);
+  ds3231_tslog_sync(&writer);
+  check_read("range", store.data, sizeof(block), sizeof(block), ends, 3, 0);
+}
+
+static void test_erased_tail(void)
+{
+  const size_t block_size = 32;
+  uint8_t block[32];
+  store_reset();
+  DS3231_TsLogWriter_t writer;
+  ds3231_tslog_writer_init(&writer, block, block_size, store_flush, &store);
+
+  int64_t entries[8];
+  for (size_t i = 0; i < 8; i++)
+  {
+    entries[i] = 1700000000 + (int64_t)i * 60;
+    ds3231_tslog_append(&writer, entries[i]);
+  }
+  ds3231_tslog_sync(&writer);
+  const size_t used = writer.used;
+  CHECK(used < block_size && store.data[used] == 0xFF && store.data[block_size - 1] == 0xFF, "tail is not erased");
+
+  // a second block after the first, then a programmed byte in the erased tail of the first
+  memcpy(&store.data[block_size], store.data, block_size);
+  const int64_t both[16] = { entries[0], entries[1], entries[2], entries[3], entries[4], entries[5],
+                             entries[6], entries[7], entries[0], entries[1], entries[2], entries[3],
+                             entries[4], entries[5], entries[6], entries[7] };
+  check_read("erased tail", store.data, 2 * block_size, block_size, both, 16, 0);
+
+  store.data[block_size - 2] = 0x7F;
+  check_read("programmed tail", store.data, 2 * block_size, block_size, both, 16, 1);
+
+  // a block which does not start with an absolute entry is skipped
+  store.data[block_size - 2] = 0xFF;
+  store.data[block_size] = 0x02;
+  check_read("relative start", store.data, 2 * block_size, block_size, entries, 8, 1);
+}
+
+static void test_resume(void)
+{
+  const size_t block_size = 24;
+  uint8_t block[24];
+  int64_t entries[64];
+  size_t count = 0;
+  store_reset();
+
+  DS3231_TsLogWriter_t writer;
+  ds3231_tslog_writer_init(&writer, block, block_size, store_flush, &store);
+  for (; count < 5; count++)
+  {
+    entries[count] = 1700000000 + (int64_t)count * 90;
+    ds3231_tslog_append(&writer, entries[count]);
+  }
+  CHECK(ds3231_tslog_sync(&writer) == 0 && store.partial == 1, "sync did not store the block");
+
+  // a reset: the block is read back from where it was stored and continued
+  uint8_t resumed[24];
+  memcpy(resumed, &store.data[store.next], block_size);
+  CHECK(ds3231_tslog_writer_resume(&writer, resumed, block_size, store_flush, &store), "resume failed");
+  CHECK(writer.last == entries[count - 1], "resumed from %lld", (long long)writer.last);
+  for (; count < 40; count++)
+  {
+    entries[count] = entries[count - 1] + 30 + (int64_t)(count % 7) * 40;
+    ds3231_tslog_append(&writer, entries[count]);
+  }
+  ds3231_tslog_sync(&writer);
+  CHECK(store.complete > 0, "no block completed after resuming");
+  check_read("resume", store.data, store.size, block_size, entries, count, 0);
+
+  // the last entries of a block stored early were lost with the write, e.g. a file cut short; the rest is continued
+  DS3231_TsLogReader_t reader;
+  ds3231_tslog_reader_init(&reader, &store.data[store.next], block_size, block_size);
+  int64_t epoch;
+  size_t kept = 0, cut = 0;
+  while (ds3231_tslog_next(&reader, &epoch))
+  {
+    if (++kept == 2)
+      cut = reader.pos;
+  }
+  CHECK(kept > 2, "only %zu entries in the last block", kept);
+  const size_t first = count - kept;
+  memcpy(resumed, &store.data[store.next], block_size);
+  memset(&resumed[cut], 0xFF, block_size - cut);
+  CHECK(ds3231_tslog_writer_resume(&writer, resumed, block_size, store_flush, &store), "resume after a cut failed");
+  CHECK(writer.used == cut && writer.last == entries[first + 1], "resumed after a cut at %zu from %lld", writer.used,
+        (long long)writer.last);
+  count = first + 2;
+  entries[count] = entries[count - 1] + 45;
+  ds3231_tslog_append(&writer, entries[count++]);
+  ds3231_tslog_sync(&writer);
+  check_read("resume after a cut", store.data, store.size, block_size, entries, count, 0);
+
+  // cut part way through an entry: the block is not continued, so a new block starts at the next location
+  memcpy(resumed, &store.data[store.next], block_size);
+  memset(&resumed[cut - 1], 0xFF, block_size - cut + 1);
+  resumed[cut - 1] = 0x80;
+  CHECK(!ds3231_tslog_writer_resume(&writer, resumed, block_size, store_flush, &store), "resumed a torn entry");
+  CHECK(writer.used == 0 && resumed[0] == 0xFF, "a torn block was not replaced by an empty block");
+}
+
+int main(void)
+{
+  const size_t block_sizes[] = { DS3231_TSLOG_MAX_ENTRY + 1, 16, 64, 256 };
+  for (size_t i = 0; i < sizeof(block_sizes) / sizeof(block_sizes[0]); i++)
+    test_round_trip(block_sizes[i]);
+  test_range();
+  test_erased_tail();
+  test_resume();
+
+  printf("%s\n", failures ? "FAILED" : "passed");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+#!/usr/bin/env python3
+"""
+Report the flash and RAM used by the DS3231 component and the worst-case stack of each public function.
+
+The objects must be compiled with -fstack-usage, and with -fcallgraph-info=su for worst-case figures; the .su and .ci
+files are expected next to each object, as gcc writes them. Worst-case stack follows calls between the objects given;
+functions marked + also call code outside them (the i2c driver, libc) which is not included.
+
+usage: ds3231_size_report.py [--size SIZE] [--nm NM] [--prefix ds3231_] object...
+"""
+import argparse
+import os
+import re
+import subprocess
+import sys
+
+NODE = re.compile(r'node: \{ title: "([^"]*)" label: "([^"]*)"')
+EDGE = re.compile(r'edge: \{ sourcename: "([^"]*)" targetname: "([^"]*)"')
+
+
+def aux_file(obj, ext):
+    # gcc names auxiliary outputs after the object with its last extension replaced
+    return os.path.splitext(obj)[0] + ext
+
+
+def section_sizes(size_tool, objects):
+    out = subprocess.run([size_tool] + objects, check=True, capture_output=True, text=True).stdout
+    sizes = {}
+    for line in out.splitlines()[1:]:
+        fields = line.split()
+        sizes[fields[5]] = (int(fields[0]), int(fields[1]), int(fields[2]))
+    return sizes
+
+
+def code_sizes(nm_tool, objects):
+    """Size of each global function, and the set of them."""
+    out = subprocess.run([nm_tool, "-S", "-t", "d"] + objects, check=True, capture_output=True, text=True).stdout
+    sizes = {}
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) == 4 and fields[2] == "T":
+            sizes[fields[3]] = int(fields[1])
+    return sizes
+
+
+def load_callgraph(objects):
+    """Frame size, callees and whether the frame is bounded, keyed by node title."""
+    frames, calls, dynamic = {}, {}, set()
+    for obj in objects:
+        ci = aux_file(obj, ".ci")
+        if not os.path.exists(ci):
+            continue
+        with open(ci) as f:
+            for line in f:
+                m = NODE.search(line)
+                if m:
+                    title, label = m.groups()
+                    parts = label.split("\\n")
+                    if len(parts) >= 3:
+                        frames[title] = int(parts[2].split()[0])
+                        if "static" not in parts[2]:
+                            dynamic.add(title)
+                    continue
+                m = EDGE.search(line)
+                if m:
+                    calls.setdefault(m.group(1), set()).add(m.group(2))
+    return frames, calls, dynamic
+
+
+def load_frames(objects):
+    """Frame sizes from .su files, used when no call graph is available."""
+    frames = {}
+    for obj in objects:
+        su = aux_file(obj, ".su")
+        if not os.path.exists(su):
+            continue
+        with open(su) as f:
+            for line in f:
+                location, size, _ = line.rstrip("\n").split("\t")
+                frames[location.rsplit(":", 1)[1]] = int(size)
+    return frames
+
+
+def worst_case(frames, calls, dynamic):
+    # global functions are referenced by bare name from other objects
+    by_name = {}
+    for title in frames:
+        by_name.setdefault(title.rsplit(":", 1)[-1], title)
+
+    memo = {}
+
+    def visit(title, stack):
+        if title in memo:
+            return memo[title]
+        if title in stack:
+            return 0, {"R"}
+        if title not in frames:
+            title = by_name.get(title, title)
+            if title not in frames:
+                return 0, {"+"}
+        deepest, notes = 0, set()
+        if title in dynamic:
+            notes.add("dyn")
+        for callee in calls.get(title, ()):
+            depth, callee_notes = visit(callee, stack | {title})
+            deepest = max(deepest, depth)
+            notes |= callee_notes
+        memo[title] = (frames[title] + deepest, notes)
+        return memo[title]
+
+    return lambda name: visit(by_name.get(name, name), frozenset())
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("--size", default="size", help="size tool, e.g. xtensa-esp32-elf-size")
+    parser.add_argument("--nm", default="nm", help="nm tool, e.g. xtensa-esp32-elf-nm")
+    parser.add_argument("--prefix", default="ds3231_", help="prefix of the public functions to report")
+    parser.add_argument("objects", nargs="+")
+    args = parser.parse_args()
+
+    sections = section_sizes(args.size, args.objects)
+    print("%-32s %8s %8s %8s" % ("object", "flash", "ram", "bss"))
+    flash = ram = 0
+    for obj, (text, data, bss) in sorted(sections.items()):
+        print("%-32s %8d %8d %8d" % (os.path.basename(obj), text + data, data + bss, bss))
+        flash += text + data
+        ram += data + bss
+    print("%-32s %8d %8d" % ("total", flash, ram))
+    print()
+
+    code = code_sizes(args.nm, args.objects)
+    frames, calls, dynamic = load_callgraph(args.objects)
+    if frames:
+        stack = worst_case(frames, calls, dynamic)
+    else:
+        own = load_frames(args.objects)
+        stack = lambda name: (own.get(name, 0), {"frame only"})
+
+    print("%-40s %8s %12s" % ("function", "code", "stack"))
+    for name in sorted(n for n in code if n.startswith(args.prefix)):
+        depth, notes = stack(name)
+        print("%-40s %8d %12d %s" % (name, code[name], depth, " ".join(sorted(notes))))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
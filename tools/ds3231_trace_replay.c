@@ -0,0 +1,237 @@
+/*
+ * Replay a trace recorded with ds3231_trace against the simulated DS3231 and report transaction counts, redundant
+ * reads and timing.
+ *
+ * Writes are applied to the simulated chip. A read is compared with the simulated registers: if every register read
+ * was already known, from an earlier read or write, and the value is unchanged, the read was redundant. Values that
+ * changed, e.g. because the clock ticked, and registers read for the first time are loaded into the simulated chip.
+ *
+ * Only raw register transfers are replayed, through ds3231_write_raw and ds3231_read_raw. The trace does not record
+ * which ds3231_* calls made the transfers, so the driver's own logic, e.g. the read cache or variant detection, is not
+ * run again: a trace recorded with the read cache enabled shows the reads that reached the chip, not those the cache
+ * would save.
+ *
+ * usage: ds3231_trace_replay [-v] [-c scl_hz] trace_file
+ */
+#include <ds3231_regs.h>
+#include <ds3231_sim.h>
+#include <ds3231_trace.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct
+{
+  uint32_t count;
+  uint32_t bytes;
+  uint32_t redundant;
+  uint64_t time_us;
+} Stats_t;
+
+// Time on the wire at scl_hz: 9 clocks per byte, plus start, repeated start and stop.
+static double wire_time_us(const DS3231_TraceRecord_t* rec, uint32_t scl_hz)
+{
+  size_t clocks = rec->write ? 9 * (2 + rec->len) + 2 : 9 * (3 + rec->len) + 3;
+  return clocks * 1e6 / scl_hz;
+}
+
+static void print_record(const DS3231_TraceRecord_t* rec, const char* note)
+{
+  printf("%12.6f %c 0x%02X %3zu", rec->time_us / 1e6, rec->write ? 'W' : 'R', rec->reg, rec->len);
+  for (size_t i = 0; rec->data && i < rec->len && i < 8; i++)
+    printf(" %02X", rec->data[i]);
+  printf("%s %6uus", rec->data && rec->len > 8 ? " ..." : "", (unsigned)rec->duration_us);
+  if (rec->res != ESP_OK)
+    printf(" error %d", rec->res);
+  printf("%s\n", note);
+}
+
+static void print_usage(const char* name)
+{
+  fprintf(stderr, "usage: %s [-v] [-c scl_hz] trace_file\n", name);
+}
+
+int main(int argc, char** argv)
+{
+  bool verbose = false;
+  uint32_t scl_hz = 400000;
+  int opt;
+  while ((opt = getopt(argc, argv, "vc:")) != -1)
+  {
+    if (opt == 'v')
+    {
+      verbose = true;
+    }
+    else if (opt == 'c')
+    {
+      scl_hz = strtoul(optarg, NULL, 0);
+    }
+    else
+    {
+      print_usage(argv[0]);
+      return 2;
+    }
+  }
+
+  if (optind >= argc || scl_hz == 0)
+  {
+    print_usage(argv[0]);
+    return 2;
+  }
+
+  FILE* file = fopen(argv[optind], "rb");
+  if (!file)
+  {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  size_t size = 0, capacity = 0;
+  uint8_t* data = NULL;
+  for (;;)
+  {
+    if (size == capacity)
+    {
+      capacity = capacity ? capacity * 2 : 65536;
+      data = realloc(data, capacity);
+      if (!data)
+      {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+      }
+    }
+    size_t got = fread(data + size, 1, capacity - size, file);
+    if (got == 0)
+      break;
+    size += got;
+  }
+  fclose(file);
+
+  DS3231_TraceReader_t reader;
+  DS3231_TraceRecord_t rec;
+  if (!ds3231_trace_reader_init(&reader, data, size))
+  {
+    fprintf(stderr, "%s: not a DS3231 trace\n", argv[optind]);
+    return 1;
+  }
+
+  // transfers beyond the DS3231 register map mean the trace was recorded on a DS3232
+  DS3231_Variant_t variant = DS3231_Variant_DS3231;
+  while (ds3231_trace_next(&reader, &rec))
+  {
+    if (rec.reg + rec.len > DS3231_REG_COUNT)
+      variant = DS3231_Variant_DS3232;
+  }
+
+  DS3231_Cfg_t cfg = ds3231_create(0);
+  if (!cfg)
+  {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  ds3231_sim_set_variant(cfg, variant);
+  ds3231_detect_variant(cfg, NULL, 0);
+  uint8_t* regs = ds3231_sim_regs(cfg);
+
+  Stats_t reads[DS3232_REG_COUNT] = { 0 }, writes[DS3232_REG_COUNT] = { 0 };
+  bool known[DS3232_REG_COUNT] = { false };
+  uint32_t failed = 0, first = 0, changed = 0, redundant = 0;
+  uint64_t bus_us = 0, redundant_us = 0;
+  double wire_us = 0;
+  int64_t end_us = 0;
+
+  ds3231_trace_reader_init(&reader, data, size);
+  while (ds3231_trace_next(&reader, &rec))
+  {
+    if (rec.reg + rec.len > DS3232_REG_COUNT)
+    {
+      fprintf(stderr, "skipped transfer of %zu bytes at 0x%02X beyond the register map\n", rec.len, rec.reg);
+      continue;
+    }
+
+    bus_us += rec.duration_us;
+    wire_us += wire_time_us(&rec, scl_hz);
+    end_us = rec.time_us + rec.duration_us;
+    Stats_t* stats = rec.write ? &writes[rec.reg] : &reads[rec.reg];
+    stats->count++;
+    stats->time_us += rec.duration_us;
+
+    const char* note = "";
+    if (rec.res != ESP_OK)
+    {
+      failed++;
+    }
+    else if (rec.write)
+    {
+      stats->bytes += rec.len;
+      esp_err_t res = ds3231_write_raw(cfg, rec.reg, rec.data, rec.len, 0);
+      if (res != ESP_OK)
+        fprintf(stderr, "replay of write to 0x%02X failed: %d\n", rec.reg, res);
+      memset(&known[rec.reg], true, rec.len);
+    }
+    else
+    {
+      stats->bytes += rec.len;
+      uint8_t buf[DS3232_REG_COUNT];
+      esp_err_t res = ds3231_read_raw(cfg, rec.reg, buf, rec.len, 0);
+      if (res != ESP_OK)
+        fprintf(stderr, "replay of read from 0x%02X failed: %d\n", rec.reg, res);
+
+      bool all_known = memchr(&known[rec.reg], false, rec.len) == NULL;
+      if (!all_known)
+      {
+        first++;
+        note = " first";
+      }
+      else if (res == ESP_OK && memcmp(buf, rec.data, rec.len) == 0)
+      {
+        redundant++;
+        stats->redundant++;
+        redundant_us += rec.duration_us;
+        note = " redundant";
+      }
+      else
+      {
+        changed++;
+      }
+      memcpy(&regs[rec.reg], rec.data, rec.len);
+      memset(&known[rec.reg], true, rec.len);
+    }
+
+    if (verbose)
+      print_record(&rec, note);
+  }
+
+  uint32_t records = 0;
+  for (size_t reg = 0; reg < DS3232_REG_COUNT; reg++)
+    records += reads[reg].count + writes[reg].count;
+
+  printf("transactions  %u (%u failed)\n", (unsigned)records, (unsigned)failed);
+  printf("reads         %u first, %u changed, %u redundant (%.3f ms)\n", (unsigned)first, (unsigned)changed,
+         (unsigned)redundant, redundant_us / 1e3);
+  printf("span          %.3f s\n", end_us / 1e6);
+  printf("bus time      %.3f ms, %.3f ms on the wire at %u Hz\n", bus_us / 1e3, wire_us / 1e3, (unsigned)scl_hz);
+  printf("\n%-8s %8s %8s %10s %10s %8s %8s %10s\n", "register", "reads", "bytes", "time_ms", "redundant", "writes",
+         "bytes", "time_ms");
+  for (size_t reg = 0; reg < DS3232_REG_COUNT; reg++)
+  {
+    if (reads[reg].count || writes[reg].count)
+    {
+      printf("0x%02X     %8u %8u %10.3f %10u %8u %8u %10.3f\n", (unsigned)reg, (unsigned)reads[reg].count,
+             (unsigned)reads[reg].bytes, reads[reg].time_us / 1e3, (unsigned)reads[reg].redundant,
+             (unsigned)writes[reg].count, (unsigned)writes[reg].bytes, writes[reg].time_us / 1e3);
+    }
+  }
+
+  ds3231_delete(cfg);
+  free(data);
+
+  if (reader.corrupt)
+  {
+    fprintf(stderr, "%s: trace is truncated or corrupt after %u transactions\n", argv[optind], (unsigned)records);
+    return 1;
+  }
+  return 0;
+}
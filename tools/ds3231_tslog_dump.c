@@ -0,0 +1,80 @@
+/*
+ * Print the timestamps stored in a log written with ds3231_tslog.
+ *
+ * usage: ds3231_tslog_dump [-b block_size] log_file
+ */
+#include <ds3231_tslog.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+  size_t block_size = 256;
+  int opt;
+  while ((opt = getopt(argc, argv, "b:")) != -1)
+  {
+    if (opt == 'b')
+    {
+      block_size = strtoul(optarg, NULL, 0);
+    }
+    else
+    {
+      fprintf(stderr, "usage: %s [-b block_size] log_file\n", argv[0]);
+      return 2;
+    }
+  }
+
+  if (optind >= argc || block_size <= DS3231_TSLOG_MAX_ENTRY)
+  {
+    fprintf(stderr, "usage: %s [-b block_size] log_file\n", argv[0]);
+    return 2;
+  }
+
+  FILE* file = fopen(argv[optind], "rb");
+  if (!file)
+  {
+    perror(argv[optind]);
+    return 1;
+  }
+
+  // a pipe or other stream which cannot seek has no size; ftell returns -1
+  long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+  if (size < 0)
+  {
+    perror(argv[optind]);
+    fclose(file);
+    return 1;
+  }
+  rewind(file);
+  uint8_t* data = malloc(size > 0 ? size : 1);
+  if (!data || fread(data, 1, size, file) != (size_t)size)
+  {
+    perror(argv[optind]);
+    fclose(file);
+    free(data);
+    return 1;
+  }
+  fclose(file);
+
+  DS3231_TsLogReader_t reader;
+  ds3231_tslog_reader_init(&reader, data, size, block_size);
+
+  int64_t epoch;
+  size_t count = 0;
+  while (ds3231_tslog_next(&reader, &epoch))
+  {
+    time_t t = (time_t)epoch;
+    struct tm tm;
+    char text[32];
+    gmtime_r(&t, &tm);
+    strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    printf("%lld %s\n", (long long)epoch, text);
+    count++;
+  }
+
+  fprintf(stderr, "%zu timestamps in %ld bytes, %u corrupt blocks\n", count, size, reader.errors);
+  free(data);
+  return reader.errors ? 1 : 0;
+}